@@ -0,0 +1,95 @@
+// CommandIndex rescans: a change to a PATH directory costs one scan, after which
+// lookups are answered from the table again. Also times lookups before and after.
+//
+//   g++ -O2 -std=c++17 -Iinclude -o command_index_check extras/command_index_check.cpp src/core/CommandIndex.cpp
+//   ./command_index_check
+//
+// Works in two scratch directories under /tmp, which it removes again. Exits 1 on
+// the first check that fails.
+#include "core/CommandIndex.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace myterm;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("%-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) ++failures;
+}
+
+static void make_exe(const std::string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd >= 0) { (void)!write(fd, "#!/bin/sh\n", 10); close(fd); }
+}
+
+// Mean ns per lookup over n lookups
+static double time_lookups(CommandIndex& index, const char* name, int n) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) index.lookup(name);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+}
+
+int main() {
+    char tmplA[] = "/tmp/cmdindexA.XXXXXX", tmplB[] = "/tmp/cmdindexB.XXXXXX";
+    if (!mkdtemp(tmplA) || !mkdtemp(tmplB)) { perror("mkdtemp"); return 1; }
+    const std::string a = tmplA, b = tmplB;
+    make_exe(b + "/foo");
+    const char* old = getenv("PATH");
+    setenv("PATH", (a + ":" + b + ":" + (old ? old : "/usr/bin:/bin")).c_str(), 1);
+
+    CommandIndex index;
+    index.lookup("foo");
+    index.lookup("foo");
+    check(index.scans() == 1, "second lookup after the first scan does not scan");
+    printf("  lookup while current: %.0f ns\n", time_lookups(index, "foo", 10000));
+
+    make_exe(a + "/foo");
+    const CommandIndex::Entry* e = index.lookup("foo");
+    check(e && e->path == a + "/foo", "a command added earlier on PATH wins");
+    size_t scans = index.scans();
+    index.lookup("foo");
+    index.lookup("foo");
+    check(index.scans() == scans, "lookups after that rescan do not scan again");
+    printf("  lookup after a change: %.0f ns\n", time_lookups(index, "foo", 10000));
+    check(index.scans() == scans, "...nor do 10000 more");
+
+    unlink((a + "/foo").c_str());
+    e = index.lookup("foo");
+    check(e && e->path == b + "/foo", "a removed command falls back to the next directory");
+
+    // A deleted directory loses its watch; nothing watches for it to come back, so
+    // take the next scan by hand (hash -r) and see that it is watched again
+    unlink((b + "/foo").c_str());
+    rmdir(b.c_str());
+    check(index.lookup("foo") == nullptr, "a deleted directory's commands are gone");
+    mkdir(b.c_str(), 0755);
+    make_exe(b + "/foo");
+    index.rehash();
+    index.lookup("foo");
+    make_exe(b + "/bar");
+    check(index.lookup("bar") != nullptr, "a directory made again is watched again");
+
+    // Leaving PATH drops the watch; later changes there are no reason to scan
+    setenv("PATH", old ? old : "/usr/bin:/bin", 1);
+    index.lookup("sh");
+    scans = index.scans();
+    make_exe(a + "/baz");
+    index.lookup("sh");
+    index.lookup("sh");
+    check(index.scans() == scans, "changes outside PATH do not scan");
+
+    unlink((a + "/baz").c_str());
+    unlink((b + "/foo").c_str());
+    unlink((b + "/bar").c_str());
+    rmdir(a.c_str());
+    rmdir(b.c_str());
+    printf("%s\n", failures ? "FAILED" : "all ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+// Parser throughput on large pasted scripts: the single-pass lexer/parser
+// (core/ShellParser) against the chain of splitters it replaced, which rescanned
+// every line once per stage (lines, ';', arguments, variables, '|', redirections).
+//
+//   g++ -O2 -std=c++17 -Iinclude -o parser_bench extras/parser_bench.cpp src/core/ShellParser.cpp
+//   ./parser_bench [lines] [rounds]      (defaults: 100000 lines, 5 rounds)
+//
+// Reports the best round of each as MB/s and ns per input line.
+#include "core/ShellParser.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace myterm;
+
+// ---- The previous splitters, as they were in TerminalWindow / CommandExecutor ----
+namespace legacy {
+
+static std::vector<std::string> split_lines_respecting_quotes(const std::string& s) {
+    std::vector<std::string> out;
+    std::string cur;
+    bool inS = false, inD = false;
+    for (char c : s) {
+        if (c == '"' && !inS) { inD = !inD; cur.push_back(c); continue; }
+        if (c == '\'' && !inD) { inS = !inS; cur.push_back(c); continue; }
+        if (c == '\n' && !inS && !inD) {
+            bool onlyWs = true; for (char k : cur) { if (!isspace((unsigned char)k)) { onlyWs = false; break; } }
+            if (!cur.empty() && !onlyWs) out.push_back(cur);
+            cur.clear();
+        } else {
+            cur.push_back(c);
+        }
+    }
+    bool onlyWs = true; for (char k : cur) { if (!isspace((unsigned char)k)) { onlyWs = false; break; } }
+    if (!cur.empty() && !onlyWs) out.push_back(cur);
+    return out;
+}
+
+static std::vector<std::string> split_by_semicolon(const std::string& s) {
+    std::vector<std::string> out; std::string cur; bool inS = false, inD = false;
+    for (size_t i = 0; i < s.size(); ++i) { char c = s[i];
+        if (c == '"' && !inS) inD = !inD; else if (c == '\'' && !inD) inS = !inS;
+        else if (!inS && !inD && c == ';') { if (!cur.empty()) { out.push_back(cur); cur.clear(); } continue; }
+        cur.push_back(c);
+    }
+    if (!cur.empty()) out.push_back(cur);
+    return out;
+}
+
+static std::vector<std::string> splitArgs(const std::string& s) {
+    std::vector<std::string> out; std::string cur; bool inSingle = false, inDouble = false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '"' && !inSingle) { inDouble = !inDouble; continue; }
+        if (c == '\'' && !inDouble) { inSingle = !inSingle; continue; }
+        if (!inSingle && !inDouble && (c == ' ' || c == '\t')) {
+            if (!cur.empty()) { out.push_back(cur); cur.clear(); }
+        } else {
+            cur.push_back(c);
+        }
+    }
+    if (!cur.empty()) out.push_back(cur);
+    return out;
+}
+
+static std::string expandVars(const std::string& s) {
+    if (!s.empty() && s[0] == '~') {
+        const char* home = getenv("HOME");
+        return std::string(home ? home : "") + s.substr(1);
+    }
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '$') {
+            size_t j = i + 1;
+            while (j < s.size() && (isalnum((unsigned char)s[j]) || s[j] == '_')) ++j;
+            std::string var = s.substr(i + 1, j - i - 1);
+            const char* val = getenv(var.c_str());
+            if (val) out += val;
+            i = j - 1;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+static std::vector<std::string> splitPipeline(const std::string& s) {
+    std::vector<std::string> parts; std::string cur; bool inS = false, inD = false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '"' && !inS) { inD = !inD; continue; } if (c == '\'' && !inD) { inS = !inS; continue; }
+        if (!inS && !inD && c == '|') { if (!cur.empty()) { parts.push_back(cur); cur.clear(); } }
+        else cur.push_back(c);
+    }
+    if (!cur.empty()) parts.push_back(cur);
+    return parts;
+}
+
+struct Redir { std::string in; std::string out; bool append = false; std::string errOut; bool errAppend = false; };
+static std::vector<std::string> splitArgsLoose(const std::string& s) {
+    std::vector<std::string> out; std::string cur; bool inS = false, inD = false;
+    for (size_t i = 0; i < s.size(); ++i) {
+        char c = s[i];
+        if (c == '"' && !inS) { inD = !inD; continue; }
+        if (c == '\'' && !inD) { inS = !inS; continue; }
+        if (!inS && !inD) {
+            if (c == ' ' || c == '\t') { if (!cur.empty()) { out.push_back(cur); cur.clear(); } continue; }
+            if (c == '<' || c == '>') {
+                if (!cur.empty()) { out.push_back(cur); cur.clear(); }
+                if (c == '>' && i + 1 < s.size() && s[i + 1] == '>') { out.emplace_back(">>"); ++i; }
+                else { out.emplace_back(std::string(1, c)); }
+                continue;
+            }
+        }
+        cur.push_back(c);
+    }
+    if (!cur.empty()) out.push_back(cur);
+    return out;
+}
+
+static std::vector<std::string> parseCmdWithRedir(const std::string& s, Redir& r) {
+    std::vector<std::string> tokens = splitArgsLoose(s);
+    std::vector<std::string> argv; for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i] == ">" || tokens[i] == ">>") { r.append = (tokens[i] == ">>"); if (i + 1 < tokens.size()) { r.out = tokens[i + 1]; ++i; } continue; }
+        if (tokens[i] == "<") { if (i + 1 < tokens.size()) { r.in = tokens[i + 1]; ++i; } continue; }
+        argv.push_back(tokens[i]);
+    }
+    return argv;
+}
+
+// Everything one pasted block went through before a command started
+static size_t parse(const std::string& src) {
+    size_t words = 0;
+    for (auto& line : split_lines_respecting_quotes(src)) {
+        for (auto& cmd : split_by_semicolon(line)) {
+            auto args = splitArgs(cmd);
+            for (auto& a : args) a = expandVars(a);
+            for (auto& stage : splitPipeline(cmd)) {
+                Redir r;
+                words += parseCmdWithRedir(stage, r).size();
+            }
+        }
+    }
+    return words;
+}
+
+} // namespace legacy
+
+static size_t parse_new(const std::string& src) {
+    ParsedScript s = parseShell(src);
+    size_t words = 0;
+    for (auto& p : s.pipelines) for (auto& c : p.stages) words += c.words.size();
+    return words;
+}
+
+static std::string make_script(size_t lines) {
+    static const char* const kLines[] = {
+        "ls -la /usr/bin | grep \"foo bar\" | sort -r > out.txt",
+        "echo 'single quoted $HOME' \"double $USER\" && make -j8 || echo failed; sleep 1 &",
+        "cat < in.txt | sort | uniq -c | head -n 20 >> log.txt",
+        "find . -name \"*.cpp\" -newer build.stamp | xargs grep -n 'TODO' 2>&1",
+        "export_dir=$HOME/projects/myterm; cd ~/src && git status --short",
+        "printf '%s\\n' \"line with \\\"escaped\\\" quotes\" | tr a-z A-Z",
+    };
+    const size_t kinds = sizeof kLines / sizeof kLines[0];
+    std::string s;
+    for (size_t i = 0; i < lines; ++i) { s += kLines[i % kinds]; s += '\n'; }
+    return s;
+}
+
+template <typename F>
+static void bench(const char* label, F parse, const std::string& src, size_t lines, int rounds) {
+    double best = 1e300;
+    size_t words = 0;
+    for (int r = 0; r < rounds; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        words = parse(src);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        best = std::min(best, s);
+    }
+    printf("%-12s %8.1f MB/s  %7.1f ns/line  (%zu words)\n",
+           label, src.size() / best / 1e6, best * 1e9 / (double)lines, words);
+}
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    if (lines < 1) lines = 1;
+    if (rounds < 1) rounds = 1;
+    std::string src = make_script(lines);
+    printf("%zu lines, %.1f MB\n", lines, src.size() / 1e6);
+    bench("splitters", legacy::parse, src, lines, rounds);
+    bench("parseShell", parse_new, src, lines, rounds);
+    return 0;
+}
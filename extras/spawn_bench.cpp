@@ -0,0 +1,80 @@
+// Spawn latency against the size of the spawning process: fork() + execvp() versus
+// posix_spawnp(), which is what the terminal uses to start commands.
+//
+//   g++ -O2 -std=c++17 -o spawn_bench extras/spawn_bench.cpp
+//   ./spawn_bench [runs per size] [MB ...]      (defaults: 200 runs; 0 64 256 1024 MB)
+//
+// For each size the process first grows its RSS by touching that many megabytes, as a
+// GUI with a long scrollback and a glyph cache would, then starts /bin/true repeatedly
+// and reports the median and 99th percentile time until the child has been reaped.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+static char* kArgv[] = {const_cast<char*>("true"), nullptr};
+
+static double now_us() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+static pid_t with_fork() {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(kArgv[0], kArgv);
+        _exit(127);
+    }
+    return pid;
+}
+
+static pid_t with_spawn() {
+    pid_t pid = -1;
+    return posix_spawnp(&pid, kArgv[0], nullptr, nullptr, kArgv, environ) == 0 ? pid : -1;
+}
+
+static void measure(const char* label, pid_t (*start)(), int runs, size_t mb) {
+    std::vector<double> us;
+    us.reserve((size_t)runs);
+    for (int i = 0; i < runs; ++i) {
+        double t0 = now_us();
+        pid_t pid = start();
+        if (pid < 0) { perror(label); exit(1); }
+        int status;
+        waitpid(pid, &status, 0);
+        us.push_back(now_us() - t0);
+    }
+    std::sort(us.begin(), us.end());
+    printf("%6zu MB  %-12s median %8.1f us   p99 %8.1f us\n",
+           mb, label, us[us.size() / 2], us[(us.size() * 99) / 100]);
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 200;
+    std::vector<size_t> sizes;
+    for (int i = 2; i < argc; ++i) sizes.push_back((size_t)atol(argv[i]));
+    if (sizes.empty()) sizes = {0, 64, 256, 1024};
+    std::sort(sizes.begin(), sizes.end());
+    if (runs < 1) runs = 1;
+
+    std::vector<char*> blocks;
+    size_t have = 0;
+    for (size_t mb : sizes) {
+        for (; have < mb; ++have) {
+            char* b = static_cast<char*>(malloc(1 << 20));
+            memset(b, 1, 1 << 20); // resident, not just reserved
+            blocks.push_back(b);
+        }
+        measure("fork+exec", with_fork, runs, mb);
+        measure("posix_spawn", with_spawn, runs, mb);
+    }
+    for (char* b : blocks) free(b);
+    return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "core/CommandIndex.hpp"
+#include "core/History.hpp"
+#include "core/Job.hpp"
+
+namespace myterm {
+
+// What the builtins operate on: the window hands in the active tab's jobs, the
+// headless shell its own.
+struct ShellContext {
+    History& history;
+    const std::string& historyPath;  // empty: history is not persisted
+    CommandIndex& commands;
+    std::vector<BackgroundJob>& jobs;
+    std::function<void(int&)> closeFd; // closes a killed job's output pipe; plain close() when unset
+};
+
+// Run args[0] if it is one of echo, history, cd, hash, bgpids, kill or killprocess.
+// What it prints is appended to out and err, its exit code stored in status.
+// False (nothing done) for any other command.
+bool runBuiltin(ShellContext& ctx, const std::vector<std::string>& args,
+                std::string& out, std::string& err, int& status);
+
+} // namespace myterm
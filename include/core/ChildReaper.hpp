@@ -0,0 +1,41 @@
+#pragma once
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace myterm {
+
+// Exit notification for forked children, for use in an event loop.
+//
+// Each tracked child gets a pidfd; fd() (an epoll set of them) becomes readable as
+// soon as one exits, and collect() reaps it with its wait status and resource usage.
+// On kernels without pidfd_open() the set holds a signalfd for SIGCHLD instead, which
+// means SIGCHLD is blocked in this process (and unblocked again in forked children):
+// construct the reaper before starting any threads.
+class ChildReaper {
+public:
+    struct Exit {
+        pid_t pid;
+        int status;      // as from waitpid()
+        rusage usage;
+    };
+
+    ChildReaper();
+    ~ChildReaper();
+    ChildReaper(const ChildReaper&) = delete;
+    ChildReaper& operator=(const ChildReaper&) = delete;
+
+    int fd() const { return epfd_; }
+    void track(pid_t pid);
+    // Reap every tracked child that has exited, appending them to `out`.
+    void collect(std::vector<Exit>& out);
+
+private:
+    int epfd_ = -1;
+    int sigFd_ = -1;  // signalfd(SIGCHLD) when pidfds are unavailable
+    int kickFd_ = -1; // eventfd: re-check children without a pidfd
+    std::vector<std::pair<pid_t, int>> children_; // pid, pidfd (-1 without one)
+};
+
+} // namespace myterm
@@ -0,0 +1,58 @@
+#pragma once
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace myterm {
+
+// Executables on PATH, by name.
+//
+// The PATH directories are scanned once into a hash table and watched with inotify;
+// fd() becomes readable when one of them changes, and handleEvents() marks the
+// table for a rescan on its next use. Every use drains fd() first, so an owner that
+// never polls it still sees changes. A changed PATH value is noticed the same way.
+// Without inotify the directories' mtimes are compared on every lookup instead.
+class CommandIndex {
+public:
+    struct Entry {
+        std::string path;  // absolute path of the first match on PATH
+        time_t mtime = 0;  // of the executable when it was indexed
+        unsigned hits = 0; // lookups that resolved to it
+    };
+
+    CommandIndex();
+    ~CommandIndex();
+    CommandIndex(const CommandIndex&) = delete;
+    CommandIndex& operator=(const CommandIndex&) = delete;
+
+    int fd() const { return inotifyFd_; }
+    void handleEvents();
+
+    // Absolute path of command `name`, or nullptr. Counts a hit.
+    const Entry* lookup(const std::string& name);
+    // Names starting with prefix, sorted.
+    std::vector<std::string> complete(const std::string& prefix);
+    // Forget everything (hash -r); the next use rescans.
+    void rehash();
+    // Rescan on the next use, keeping the hit counts (an indexed path that failed).
+    void invalidate() { stale_ = true; }
+    // Commands that have been looked up at least once, sorted by name.
+    std::vector<std::pair<std::string, const Entry*>> remembered();
+    // PATH scans so far
+    size_t scans() const { return scans_; }
+
+private:
+    void refresh(); // rescan if stale
+    void scan();
+
+    int inotifyFd_ = -1;
+    bool stale_ = true;
+    std::string path_;                        // PATH the table was built from
+    std::vector<std::pair<std::string, time_t>> dirs_; // scanned directories and their mtimes
+    std::unordered_map<std::string, int> watches_; // directory -> inotify watch, kept across scans
+    size_t scans_ = 0;
+    std::unordered_map<std::string, Entry> table_;
+};
+
+} // namespace myterm
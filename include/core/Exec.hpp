@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include "core/CommandIndex.hpp"
+#include "core/ShellParser.hpp"
+#include "core/Spawn.hpp"
+
+namespace myterm {
+
+// Starting parsed pipelines, shared by the window and the headless shell.
+
+// argv for a parsed command: only words with unquoted wildcards go through glob()
+std::vector<std::string> expandWords(const std::vector<Word>& words);
+
+// What the shell prints for a command that could not be started
+std::string spawnError(const std::string& cmd, int err);
+
+// Absolute path of a command through the index, `name` itself when it has a '/',
+// or empty to let posix_spawnp() search PATH
+std::string resolveCommand(CommandIndex& commands, const std::string& name);
+
+// sp.run() with the command resolved through the index. An indexed path that is
+// gone (ENOENT) sends the index back to PATH for one more try before failing.
+pid_t spawnCommand(Spawn& sp, CommandIndex& commands, const std::vector<std::string>& argv);
+
+// Where a pipeline's ends go. -1 keeps the descriptor this process has.
+struct PipelineIo {
+    int in = -1;          // stdin of the first stage
+    int out = -1;         // stdout of the last stage
+    int err = -1;         // stderr of every stage
+    bool ownGroup = true; // stages share a new process group led by the first
+};
+
+struct LaunchedPipeline {
+    std::vector<pid_t> pids; // stages that started, in order
+    pid_t pgid = -1;         // their group; -1 when none started or ownGroup was off
+    pid_t last = -1;         // the last stage, whose status is the pipeline's; -1 if it did not start
+    int failStatus = 0;      // exit code when `last` is -1: 127 not found, 1 redirection failed
+    std::string errors;      // messages for stages that did not start
+};
+
+// Start every stage with the pipes between them. Redirections apply after the pipe
+// wiring, in source order; their files are opened here so a failure is reported
+// without starting the stage. Never blocks on the children.
+LaunchedPipeline launchPipeline(const Pipeline& p, const PipelineIo& io, CommandIndex& commands);
+
+} // namespace myterm
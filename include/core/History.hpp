@@ -14,6 +14,7 @@ public:
     // search: exact (most recent) else longest substring (>2)
     int search(const std::string& term) const;
     // Persistence
+    static std::string defaultPath(); // ~/.myterm_history; empty without a home directory
     void loadFromFile(const std::string& path);
     void appendToFile(const std::string& path, const std::string& cmd) const;
     void saveToFile(const std::string& path) const;
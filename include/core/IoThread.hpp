@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "core/SpscQueue.hpp"
+
+namespace myterm {
+
+// Reader thread for child output pipes and PTY masters.
+//
+// Watched descriptors are read on this thread in large chunks and handed to the
+// UI thread through a lock-free SPSC queue; wakeFd() becomes readable when there is
+// something to pop. When the UI falls behind the queue fills up and the thread stops
+// reading, which in turn blocks the children on write().
+//
+// At EOF or a read error the thread stops watching the descriptor by itself and
+// queues an `eof` chunk; closing it is left to the UI. A descriptor the UI wants to
+// close earlier must be unwatch()ed first.
+class IoThread {
+public:
+    struct Chunk {
+        int fd = -1;
+        bool eof = false;   // read() returned 0 or failed: fd is no longer watched
+        uint64_t seq = 0;
+        std::string data;
+    };
+
+    IoThread();
+    ~IoThread();
+    IoThread(const IoThread&) = delete;
+    IoThread& operator=(const IoThread&) = delete;
+
+    int wakeFd() const { return wakeFd_; }
+    void clearWake();            // consume the wakeup before popping
+
+    // Start reading fd (non-blocking) on the thread; -1 and repeats are ignored.
+    void watch(int fd);
+    // Stop reading fd. Afterwards the thread does not touch it, and data already
+    // queued for it is discarded by pop(), so it can be closed and its number reused.
+    void unwatch(int fd);
+    // Oldest queued chunk; false when the queue is empty. UI thread only.
+    bool pop(Chunk& c);
+
+private:
+    void loop();
+    bool readFd(int fd); // false when the queue filled up
+
+    static constexpr size_t kChunkBytes = 64 * 1024;
+    static constexpr size_t kQueueChunks = 256;  // at most 16 MB read ahead of the UI
+    static constexpr int kReadsPerWake = 4;      // per descriptor, so one busy child can't starve the rest
+
+    int epfd_ = -1;
+    int wakeFd_ = -1;  // eventfd, thread -> UI: chunks queued
+    int kickFd_ = -1;  // eventfd, UI -> thread: queue drained or stopping
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> waiting_{false}; // thread is blocked on a full queue
+
+    std::mutex mutex_;       // held by the thread while it reads; guards fds_ and seq_
+    std::vector<int> fds_;   // watched descriptors
+    uint64_t seq_ = 0;       // chunks pushed so far
+    SpscQueue<Chunk> queue_{kQueueChunks};
+    Chunk scratch_;          // thread side buffer, recycled through the queue
+
+    // UI thread: chunks of fd with seq below the bound predate an unwatch() and are dropped
+    std::vector<std::pair<int, uint64_t>> dropped_;
+
+    std::thread thread_;
+};
+
+} // namespace myterm
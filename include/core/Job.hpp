@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include <sys/types.h>
+
+namespace myterm {
+
+// A pipeline started with '&'. The window reads its output through outFd/errFd;
+// the headless shell leaves them at -1 and lets the job write where it inherited.
+struct BackgroundJob {
+    pid_t pid;
+    pid_t pgid;
+    int outFd;
+    int errFd;
+    std::string cmd;
+    bool isPty = false; // true when outFd refers to a PTY master (interactive job)
+    bool exited = false; // reaped; the job is dropped once its pipes have drained too
+};
+
+} // namespace myterm
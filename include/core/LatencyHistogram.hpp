@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace myterm {
+
+// Histogram of durations in microseconds, in the manner of HdrHistogram: values
+// below 64 get a bucket each, and every power-of-two range above is split into 32
+// equal buckets, so a bucket is never wider than about 3% of the values in it. A
+// value is recorded in O(1) with no allocation once its range has been seen; memory
+// grows with the largest value only (at most a few KiB for hours).
+class LatencyHistogram {
+public:
+    void record(uint64_t us);
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    // Smallest recorded value that `q` (0..1) of all values are at or below, to
+    // within the bucket width (never above max()); 0 when nothing was recorded
+    uint64_t quantile(double q) const;
+
+private:
+    static constexpr unsigned kSubBits = 6;                    // 64 exact values, then 32 per octave
+    static constexpr uint64_t kLinear = 1ull << kSubBits;
+    static constexpr uint64_t kHalf = kLinear / 2;
+    static size_t bucketOf(uint64_t v);
+    static uint64_t highestIn(size_t bucket);                  // largest value bucket `bucket` holds
+
+    std::vector<uint32_t> buckets_;
+    uint64_t count_ = 0;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+};
+
+} // namespace myterm
@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace myterm {
+
+// What to do when a round is still running at the next tick
+enum class Overlap {
+    Skip,  // let it finish; ticks that pass meanwhile are dropped
+    Queue, // start the next round as soon as it finishes (at most one waits)
+    Kill,  // kill what is left of it and start the next round on time
+};
+
+struct MultiWatchSpec {
+    long long intervalMs = 2000;
+    Overlap overlap = Overlap::Skip;
+    size_t jobs = 0;          // --jobs=N: commands running at once; 0 runs all of a round together
+    long long timeoutMs = 0;  // --timeout=T: a command still running after T is killed; 0 never
+    bool stats = false;       // --stats: a summary row per round in text, and a report on exit
+    std::string logPath;      // --log=FILE: structured log of every start, output chunk and end
+    bool logBinary = false;   // --log-format=binary instead of JSON Lines
+    std::vector<std::string> cmds;
+    bool highlight = false;   // -d: mark the lines that differ from the last round
+    bool changesOnly = false; // --changes-only: text output leaves unchanged lines out
+    bool records = false; // write WatchRecords (core/WatchPanes.hpp) instead of text
+};
+
+// multiWatch [-d] [--changes-only] [--stats] [--overlap=skip|queue|kill] [--jobs=N]
+//            [--timeout=T] [--log=FILE [--log-format=jsonl|binary]] [interval] ["cmd1", "cmd2", ...]
+// OR multiWatch [...] cmd1 cmd2 ...
+// args[0] is "multiWatch"; options come in any order before the interval. The interval
+// and T are seconds (2, 0.5, 2s) or milliseconds (250ms).
+// False with a message in `error` when the arguments make no sense.
+bool parseMultiWatch(const std::vector<std::string>& args, MultiWatchSpec& spec, std::string& error);
+
+// The multiWatch worker: runs every command under sh once per interval and writes
+// their output, framed with a header per command, to stdout.
+//
+// Commands run in a pool of long-lived `sh` processes, --jobs of them (one per command
+// by default), so a round costs no shell startups. A shell reads one command line at a
+// time from a pipe and answers on another, ending the command's output with a sentinel
+// unique to the worker. The shells stay across rounds; one whose command exits it, or
+// that is killed for a timeout or the kill policy, is started again when next needed.
+// Each command starts in the worker's directory with stdin from /dev/null; shell
+// variables it sets live on in its shell. Nothing touches the filesystem.
+//
+// Rounds start on absolute deadlines (a CLOCK_MONOTONIC timerfd: start + k * interval),
+// so the period does not drift by the commands' run time. Each header reports the
+// round's jitter, how late its command actually started against its deadline (with
+// --jobs, that includes waiting for a free shell).
+//
+// Each command's output is compared line by line with its previous round through a
+// 64-bit hash per line, line k against line k as `watch -d` does. Records carry only
+// the lines that differ; runs of unchanged lines go out as a count (WatchRecord::Keep).
+// In text, -d shows changed lines in reverse video and --changes-only prints just
+// those, numbered, leaving out a command whose output did not change at all.
+//
+// Each command's runtime (CLOCK_MONOTONIC, from the moment its shell is handed the
+// command until its sentinel is read) goes into a LatencyHistogram, and its exit
+// status into a count per status. Records carry a summary row per round
+// (WatchRecord::Stats); text shows it with --stats. With --stats, an interrupted
+// worker finishes by writing a report on every command (WatchRecord::Report).
+// With --log, every command start, output chunk and end is also appended to FILE
+// (core/WatchLog.hpp) by a writer thread, so the file never holds up the rounds.
+// Runs until SIGINT/SIGTERM/SIGHUP/SIGQUIT, which also kill the commands of the
+// current round. Meant for a forked child.
+[[noreturn]] void runMultiWatch(const MultiWatchSpec& spec);
+
+} // namespace myterm
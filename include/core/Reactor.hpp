@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <sys/epoll.h>
+
+namespace myterm {
+
+// Level-triggered epoll set of file descriptors waited on for input. A descriptor
+// is reported while it is readable, hung up or in error, identified by its number.
+class Reactor {
+public:
+    Reactor();
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    bool valid() const { return epfd_ >= 0; }
+    // Start watching fd; watching it again is harmless.
+    void watch(int fd);
+    // Stop watching fd (descriptors closed by every holder drop out on their own).
+    void unwatch(int fd);
+    // Block up to timeoutMs (-1: forever) and return the number of ready descriptors.
+    int wait(int timeoutMs);
+    int readyFd(int i) const { return events_[i].data.fd; }
+
+private:
+    static constexpr int kMaxEvents = 32;
+    int epfd_ = -1;
+    epoll_event events_[kMaxEvents];
+};
+
+// timerfd on CLOCK_MONOTONIC; becomes readable when it expires.
+class TimerFd {
+public:
+    TimerFd();
+    ~TimerFd();
+    TimerFd(const TimerFd&) = delete;
+    TimerFd& operator=(const TimerFd&) = delete;
+
+    int fd() const { return fd_; }
+    void every(int ms);              // periodic, first expiry ms from now
+    void at(unsigned long long us);  // one shot at an absolute monotonic time (microseconds)
+    void disarm();
+    uint64_t consume();              // expirations since the last call (0 if none)
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace myterm
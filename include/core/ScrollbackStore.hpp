@@ -0,0 +1,156 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "core/TextStyle.hpp"
+
+namespace myterm {
+
+// Scrollback text kept in fixed-size chunks arranged as a ring. Appending copies
+// into the newest chunk and evicting the oldest line only advances the head of
+// the oldest chunk, so neither operation moves the rest of the buffer.
+//
+// A line never straddles two chunks: when the unterminated last line outgrows
+// its chunk it is moved to a fresh one. Every line is therefore a contiguous
+// string_view into chunk memory. A line index (chunk, offset, length per line)
+// is maintained as text arrives, so lineCount() and line(i) are O(1).
+//
+// Offsets returned by endOffset() are absolute stream positions that keep
+// counting across evictions and clears, so a saved mark can be passed back to
+// truncate() later even if older output has been dropped in between.
+//
+// Text attributes are kept beside the text as style runs (line-relative start,
+// length, style), stored in line order in one queue; each line records where
+// its runs begin. Unstyled text has no runs at all.
+class ScrollbackStore {
+public:
+    static constexpr size_t kChunkSize = 64 * 1024;
+    static constexpr size_t kDefaultMaxLines = 100000;
+    static constexpr size_t kDefaultMaxBytes = 1 << 20;
+
+    // Limits of 0 mean "unlimited".
+    explicit ScrollbackStore(size_t maxLines = kDefaultMaxLines, size_t maxBytes = kDefaultMaxBytes);
+    // Non-copyable; use swap() to exchange contents without copying text
+    ScrollbackStore(const ScrollbackStore&) = delete;
+    ScrollbackStore& operator=(const ScrollbackStore&) = delete;
+
+    void setLimits(size_t maxLines, size_t maxBytes);
+    size_t maxLines() const { return maxLines_; }
+    size_t maxBytes() const { return maxBytes_; }
+
+    void append(std::string_view s) { append(s, nullptr, 0); }
+    // Append text whose runs (offsets into s, non-overlapping, ascending) may span lines.
+    void append(const StyledText& st) { append(st.text, st.runs.data(), st.runs.size()); }
+    void append(std::string_view s, const StyleRun* runs, size_t nRuns);
+    void clear();
+    // Drop everything from absolute offset `pos` to the end.
+    void truncate(size_t pos);
+    // Replace the unterminated last line (if any) with s; used to edit the line in place.
+    void replaceOpenLine(std::string_view s, const StyleRun* runs, size_t nRuns);
+    // Exchange contents (not limits) without copying any text.
+    void swap(ScrollbackStore& other) noexcept;
+
+    size_t size() const { return bytes_; }
+    bool empty() const { return bytes_ == 0; }
+    // The last line has no '\n' yet, so more output continues it.
+    bool lastLineOpen() const { return open_; }
+    size_t beginOffset() const { return beginOffset_; }
+    size_t endOffset() const { return beginOffset_ + bytes_; }
+    // Lines as split on '\n'; an unterminated last line counts, a trailing '\n' does not add one.
+    size_t lineCount() const { return lines_.size(); }
+    // Absolute number of line(0): counts every line ever evicted or cleared from the front.
+    size_t firstLine() const { return firstLine_; }
+    // Lowest absolute line whose text changed in place (open line extended, truncate, clear, swap)
+    // since the last call; SIZE_MAX if none. Lines appended after that are new, not changed.
+    // Intended for a single consumer that caches per-line data (the tab's wrap cache).
+    size_t takeDirtyFrom() { size_t d = dirtyFrom_; dirtyFrom_ = (size_t)-1; return d; }
+    // Line i (0 = oldest retained), without its '\n'. Valid until the next mutation.
+    std::string_view line(size_t i) const {
+        const LineRef& r = lines_[i];
+        return std::string_view(chunkAt((size_t)(r.seq - frontSeq_)).data.get() + r.pos, r.len);
+    }
+
+    class LineIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = std::string_view;
+
+        LineIterator() = default;
+        std::string_view operator*() const { return store_->line(i_); }
+        LineIterator& operator++() { ++i_; return *this; }
+        LineIterator operator++(int) { LineIterator tmp = *this; ++i_; return tmp; }
+        bool operator==(const LineIterator& o) const { return i_ == o.i_; }
+        bool operator!=(const LineIterator& o) const { return i_ != o.i_; }
+
+    private:
+        friend class ScrollbackStore;
+        LineIterator(const ScrollbackStore* s, size_t i) : store_(s), i_(i) {}
+
+        const ScrollbackStore* store_ = nullptr;
+        size_t i_ = 0;
+    };
+
+    // Style runs of line i, starts relative to the line. Replaces the contents of `out`.
+    void lineRuns(size_t i, std::vector<StyleRun>& out) const;
+
+    LineIterator begin() const { return LineIterator(this, 0); }
+    LineIterator end() const { return LineIterator(this, lines_.size()); }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t cap = 0;
+        size_t head = 0; // first live byte
+        size_t tail = 0; // one past the last live byte
+    };
+    // Where a line lives: chunks are numbered by a sequence that survives ring growth
+    struct LineRef {
+        uint64_t seq; // chunk sequence number (front chunk is frontSeq_)
+        uint32_t pos; // byte offset of the line inside the chunk
+        uint32_t len; // length without the '\n'
+        uint64_t run; // absolute index of the line's first style run (runsFront_ numbering)
+    };
+
+    Chunk& chunkAt(size_t i) { return ring_[(first_ + i) % ring_.size()]; }
+    const Chunk& chunkAt(size_t i) const { return ring_[(first_ + i) % ring_.size()]; }
+    Chunk& pushChunk(size_t minCap);
+    void popFrontChunk();
+    void popBackChunk();
+    void copyIn(std::string_view s);
+    void relocateOpenLine(size_t extra);
+    bool evictFrontLine();
+    void enforceLimits();
+    void markDirty(size_t absLine) { if (absLine < dirtyFrom_) dirtyFrom_ = absLine; }
+    uint64_t runsEnd() const { return runsFront_ + runs_.size(); }
+    uint64_t runsEndOf(size_t i) const { return i + 1 < lines_.size() ? lines_[i + 1].run : runsEnd(); }
+    void addRuns(size_t firstLine, size_t firstCol, std::string_view s, const StyleRun* runs, size_t nRuns);
+    void clipLastLineRuns(size_t from, size_t to);
+
+    std::vector<Chunk> ring_;
+    size_t first_ = 0;  // ring slot of the oldest chunk
+    size_t count_ = 0;  // chunks in use
+    uint64_t frontSeq_ = 0; // sequence number of the oldest chunk
+    std::unique_ptr<char[]> spare_; // recycled kChunkSize buffer
+
+    std::deque<LineRef> lines_;
+    bool open_ = false; // last line has no '\n' yet (and lives in the newest chunk)
+    size_t firstLine_ = 0;
+    size_t dirtyFrom_ = (size_t)-1;
+    std::deque<StyleRun> runs_;
+    uint64_t runsFront_ = 0; // absolute index of runs_.front()
+
+    size_t bytes_ = 0;
+    size_t beginOffset_ = 0;
+    size_t maxLines_ = 0;
+    size_t maxBytes_ = 0;
+};
+
+} // namespace myterm
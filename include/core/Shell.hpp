@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "core/CommandIndex.hpp"
+#include "core/Exec.hpp"
+#include "core/History.hpp"
+#include "core/Job.hpp"
+
+namespace myterm {
+
+// The shell without a window, for `myshell -c '...'` and `myshell script.sh`.
+//
+// Commands run one after another with their output going straight to this
+// process's stdout and stderr; nothing is captured or emulated. Foreground
+// pipelines stay in the caller's process group so the terminal's Ctrl+C reaches
+// them; `&` jobs get a group of their own and /dev/null as stdin.
+class Shell {
+public:
+    Shell();
+
+    // Run every command in src. Returns the exit code of the last one, like sh:
+    // 128+N for a signal, 2 for a syntax error (nothing runs then).
+    int run(const std::string& src);
+    // Run a script file; 127 when it cannot be read
+    int runFile(const std::string& path);
+
+private:
+    int runPipeline(const Pipeline& p);
+    int runMultiWatch(const std::vector<std::string>& args);
+    int wait(const LaunchedPipeline& lp);
+    void reapJobs();
+
+    History history_;
+    std::string historyPath_; // read for `history`; scripts add nothing to it
+    CommandIndex commands_;
+    std::vector<BackgroundJob> jobs_;
+    bool exit_ = false;       // `exit` ran, or a foreground job was interrupted
+};
+
+} // namespace myterm
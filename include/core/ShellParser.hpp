@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace myterm {
+
+// Shell input, parsed in a single pass over the text.
+//
+// A script is a sequence of pipelines in execution order. Each one records how it
+// joins the pipeline before it (`;` or a newline, `&&`, `||`), so an and-or list is a
+// run of And/Or joins. `&` puts the pipeline before it in the background.
+// Words come out with quotes removed and with $VAR, ${VAR} and a leading ~ expanded;
+// pathname expansion is left to the executor.
+
+struct Word {
+    std::string text;
+    bool glob = false; // has an unquoted * ? or [
+};
+
+struct Redirect {
+    enum Op { Read, Write, Append, Dup };
+    int fd = 1;          // descriptor being redirected
+    Op op = Write;
+    std::string target;  // file, for Read/Write/Append
+    int dupFd = -1;      // Dup: fd becomes a copy of dupFd (2>&1)
+};
+
+struct SimpleCommand {
+    std::vector<Word> words;
+    std::vector<Redirect> redirects; // in source order; applied after the pipe wiring
+};
+
+enum class Connector { Seq, And, Or };
+
+struct Pipeline {
+    Connector join = Connector::Seq; // to the previous pipeline
+    bool background = false;         // followed by '&'
+    std::vector<SimpleCommand> stages;
+    std::string text;                // as typed, for echo and the job list
+    size_t line = 0;                 // index into ParsedScript::lines
+};
+
+struct ParsedScript {
+    std::vector<Pipeline> pipelines;
+    std::vector<std::string> lines;  // source of each complete command line (may span newlines)
+    bool incomplete = false;         // ended inside quotes or after | && ||: wants more input
+    std::string error;               // syntax error; empty when the input parsed
+};
+
+ParsedScript parseShell(const std::string& src);
+
+} // namespace myterm
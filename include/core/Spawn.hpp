@@ -0,0 +1,47 @@
+#pragma once
+#include <spawn.h>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+namespace myterm {
+
+// Start a program with posix_spawn() instead of fork() + exec().
+//
+// glibc runs the child on clone(CLONE_VM | CLONE_VFORK): it borrows this process's
+// memory until it execs, so starting a command no longer copies page tables or takes
+// copy-on-write faults in proportion to the GUI's footprint. Whatever the child used
+// to do between fork() and exec() is described up front instead: descriptor moves,
+// the process group or session, environment overrides. Signal dispositions and the
+// signal mask are reset for every child.
+//
+// Descriptors the child should not inherit must be close-on-exec; the targets of
+// dup2() never are.
+class Spawn {
+public:
+    Spawn();
+    ~Spawn();
+    Spawn(const Spawn&) = delete;
+    Spawn& operator=(const Spawn&) = delete;
+
+    void dup2(int fd, int target);
+    // Open path onto target in the child, after setsid() when newSession() was asked for
+    void open(int target, const std::string& path, int flags, mode_t mode = 0);
+    void setProcessGroup(pid_t pgid);   // 0: a new group led by the child
+    // setsid() in the child; a terminal it then open()s becomes its controlling tty
+    void newSession();
+    void setEnv(const std::string& name, const std::string& value);
+
+    // Execute `path`, or search PATH for argv[0] like execvp() when it is empty.
+    // Returns the child's pid, or -1 with errno set (ENOENT when there is no such command).
+    pid_t run(const std::vector<std::string>& argv, const std::string& path = std::string());
+
+private:
+    posix_spawn_file_actions_t actions_;
+    posix_spawnattr_t attr_;
+    short flags_ = 0;
+    std::vector<std::pair<std::string, std::string>> env_;
+};
+
+} // namespace myterm
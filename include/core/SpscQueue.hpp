@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace myterm {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+//
+// push() and pop() swap with the slot instead of moving out of it, so the element
+// a consumer hands back on its next pop() is the buffer the producer gets to reuse:
+// with std::string payloads the steady state allocates nothing.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        slots_.resize(n);
+        mask_ = n - 1;
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer: false when full. On success `v` holds a recycled element.
+    bool push(T& v) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) return false;
+        std::swap(slots_[tail & mask_], v);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: false when empty. The previous contents of `out` go back into the ring.
+    bool pop(T& out) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        std::swap(out, slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Producer side check
+    bool full() const {
+        return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_seq_cst) > mask_;
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0}; // next slot to pop
+    alignas(64) std::atomic<size_t> tail_{0}; // next slot to push
+};
+
+} // namespace myterm
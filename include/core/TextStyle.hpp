@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace myterm {
+
+// Character attributes decoded from SGR (CSI ... m). Colors are xterm palette
+// indices (0-15 ANSI, 16-255 cube/grayscale) or kDefaultColor for the theme's.
+struct TextStyle {
+    static constexpr uint16_t kDefaultColor = 0xFFFF;
+    enum : uint8_t { Bold = 1, Dim = 2, Italic = 4, Underline = 8, Inverse = 16, Strike = 32 };
+
+    uint16_t fg = kDefaultColor;
+    uint16_t bg = kDefaultColor;
+    uint8_t flags = 0;
+
+    bool isDefault() const { return fg == kDefaultColor && bg == kDefaultColor && flags == 0; }
+    bool operator==(const TextStyle& o) const { return fg == o.fg && bg == o.bg && flags == o.flags; }
+    bool operator!=(const TextStyle& o) const { return !(*this == o); }
+};
+
+// Bytes [start, start+len) of a line drawn with `style`. Text outside any run uses the default style.
+struct StyleRun {
+    uint32_t start = 0;
+    uint32_t len = 0;
+    TextStyle style;
+};
+
+// Output text with escape sequences removed; runs index into `text` and may span '\n'.
+struct StyledText {
+    std::string text;
+    std::vector<StyleRun> runs;
+
+    bool empty() const { return text.empty(); }
+    // Append s in style st, merging with the previous run when the style continues.
+    void append(const char* s, size_t n, const TextStyle& st);
+};
+
+// Apply SGR parameters (already split on ';' or ':') to `pen`. An empty list means reset.
+// Handles 0/1/2/3/4/7/9, their 2x resets, 30-37/90-97, 40-47/100-107, 39/49 and
+// 38/48 with ;5;n (palette) or ;2;r;g;b (mapped to the nearest palette entry).
+void applySgr(TextStyle& pen, const int* params, size_t n);
+
+} // namespace myterm
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace myterm {
+
+// Byte-level escape sequence parser modelled on the DEC/xterm state machine.
+// It only classifies input; what a sequence means is up to the Handler.
+// State survives across feed() calls, so sequences may be split between reads.
+class VtParser {
+public:
+    static constexpr size_t kMaxParams = 32;
+
+    struct Handler {
+        virtual ~Handler() = default;
+        // A stretch of printable bytes (UTF-8, no C0 controls or DEL).
+        virtual void print(std::string_view text) = 0;
+        // A C0 control (BS, HT, LF, CR, ...); BEL included.
+        virtual void execute(char c) = 0;
+        // CSI: params (omitted ones are 0, ':' sub-params are flattened), private
+        // prefix ('?', '>', '=', '<' or 0), last intermediate byte (or 0) and final byte.
+        virtual void csi(const int* params, size_t n, char prefix, char intermediate, char final) = 0;
+        // ESC with an optional intermediate byte (e.g. ESC ( B) and final byte.
+        virtual void esc(char intermediate, char final) = 0;
+        // OSC payload without the introducer and terminator.
+        virtual void osc(std::string_view) {}
+    };
+
+    void feed(const char* data, size_t n, Handler& h);
+    void reset();
+
+private:
+    enum class State : uint8_t { Ground, Escape, EscapeInter, Csi, CsiIgnore, Osc, OscEsc, String, StringEsc };
+
+    void beginCsi();
+    void dispatchCsi(char final, Handler& h);
+
+    State state_ = State::Ground;
+    int params_[kMaxParams] = {};
+    size_t nParams_ = 0;
+    bool paramOpen_ = false; // digits or a separator seen for the current parameter
+    char prefix_ = 0;
+    char inter_ = 0;
+    std::string osc_;
+};
+
+} // namespace myterm
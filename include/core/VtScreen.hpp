@@ -0,0 +1,130 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "core/ScrollbackStore.hpp"
+#include "core/TextStyle.hpp"
+#include "core/VtParser.hpp"
+
+namespace myterm {
+
+// Marks that join the previous character instead of taking a cell of their own
+bool isCombining(char32_t cp);
+// Cells taken by a stretch of UTF-8 text: one per code point, combining marks excluded
+size_t cellCount(std::string_view s);
+
+// xterm-style terminal emulator fed with a child's output.
+//
+// The primary screen is the scrollback itself: output is appended to the
+// store as lines, and the cursor only moves within the last (open) line. CR,
+// BS, cursor-forward/back, EL, ECH, ICH and DCH edit that line in place, so
+// progress bars and line editors overwrite text instead of adding lines.
+// Vertical cursor motion has no meaning there and is ignored.
+//
+// The alternate screen (?1049h, ?1047h, ?47h) is a cell grid of the viewport
+// size with full cursor addressing, scroll regions, insert/delete line and
+// erase. Full-screen programs repaint cells in place and never touch the
+// scrollback. Rows changed since the last clearDirty() are flagged for the renderer.
+class VtScreen : private VtParser::Handler {
+public:
+    struct Cell {
+        char32_t ch = U' ';
+        char32_t comb = 0; // one combining mark, if any
+        TextStyle style;
+    };
+
+    explicit VtScreen(ScrollbackStore& primary);
+
+    void feed(const char* data, size_t n);
+    // Forget parser state, pen and modes (e.g. between commands); leaves the alternate screen.
+    void reset();
+    void resize(int cols, int rows);
+    int cols() const { return cols_; }
+    int rows() const { return rows_; }
+
+    bool altActive() const { return alt_; }
+    bool cursorVisible() const { return cursorVisible_; }
+    bool appCursorKeys() const { return appCursorKeys_; }
+    // Alternate screen cursor (0-based).
+    int cursorRow() const { return row_; }
+    int cursorCol() const { return std::min(col_, cols_ - 1); }
+    const Cell& cell(int row, int col) const { return grid_[(size_t)row * (size_t)cols_ + (size_t)col]; }
+    // Row of the alternate screen as UTF-8 with style runs; rebuilt only after the row changes.
+    const StyledText& rowText(int row);
+    bool rowDirty(int row) const { return dirty_[(size_t)row] != 0; }
+    void clearDirty();
+
+    // True once after a screen clear (CSI 2J/3J) wiped the primary scrollback.
+    bool takeCleared() { bool c = cleared_; cleared_ = false; return c; }
+    // Bytes the terminal owes the child (cursor position / device attribute reports).
+    std::string takeReplies() { std::string r; r.swap(replies_); return r; }
+
+private:
+    // VtParser::Handler
+    void print(std::string_view text) override;
+    void execute(char c) override;
+    void csi(const int* params, size_t n, char prefix, char intermediate, char final) override;
+    void esc(char intermediate, char final) override;
+
+    // Primary screen (the scrollback's open line)
+    void syncPrimary();
+    void recordSync();
+    void flushPending();
+    void printPrimary(std::string_view text);
+    void spliceLine(size_t fromCell, size_t toCell, std::string_view repl);
+    void saveCursor();
+    void restoreCursor();
+
+    // Alternate screen
+    void setAlt(bool on, bool saveCursor);
+    Cell blank() const;
+    Cell& at(int row, int col) { return grid_[(size_t)row * (size_t)cols_ + (size_t)col]; }
+    void markDirty(int row) { dirty_[(size_t)row] = 1; stale_[(size_t)row] = 1; }
+    void markAllDirty();
+    void putChar(char32_t cp);
+    void lineFeed();
+    void scrollUp(int top, int bottom, int n);
+    void scrollDown(int top, int bottom, int n);
+    void eraseCells(int row, int from, int to);
+    void setMode(const int* params, size_t n, char prefix, bool on);
+
+    ScrollbackStore& store_;
+    VtParser parser_;
+    TextStyle pen_;
+    int cols_ = 80;
+    int rows_ = 24;
+
+    // Primary screen state
+    StyledText pending_;     // text not yet handed to the store (cursor at end of line)
+    size_t col0_ = 0;        // cursor column in the open line, in cells
+    size_t lineCells_ = 0;   // cells in the open line, including pending_
+    size_t syncBegin_ = 0, syncEnd_ = 0, syncFirst_ = 0, syncLines_ = 0; // store state after our last write
+    size_t savedCol0_ = 0;
+    bool cleared_ = false;
+    StyledText edit_;               // scratch for spliceLine
+    std::vector<StyleRun> lineRuns_;
+
+    // Alternate screen state
+    bool alt_ = false;
+    std::vector<Cell> grid_;
+    std::vector<uint8_t> dirty_;  // changed since clearDirty()
+    std::vector<uint8_t> stale_;  // rowCache_ entry needs rebuilding
+    std::vector<StyledText> rowCache_;
+    int row_ = 0, col_ = 0;       // col_ == cols_ means a wrap is pending
+    int top_ = 0, bottom_ = 23;   // scroll region, inclusive
+    bool originMode_ = false;
+    bool autoWrap_ = true;
+    bool insertMode_ = false;
+    int savedRow_ = 0, savedCol_ = 0;
+    TextStyle savedPen_;
+
+    bool cursorVisible_ = true;
+    bool appCursorKeys_ = false;
+    std::string replies_;
+    std::string utf8Carry_;       // incomplete UTF-8 sequence at the end of a print() on the grid
+};
+
+} // namespace myterm
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/SpscQueue.hpp"
+
+namespace myterm {
+
+// Structured multiWatch log (--log): one record per command start, output chunk and
+// command end, with the command index, the round number and nanosecond timestamps
+// from CLOCK_MONOTONIC and CLOCK_REALTIME taken when the worker saw the event.
+//
+// The watch loop only stamps an event and swaps it into a lock-free queue; encoding
+// and writing happen on a writer thread of their own, which appends whatever piled
+// up in one write() (up to kBatchBytes). The loop never waits on the file: when the
+// writer falls behind and the queue is full, events are dropped and counted, and a
+// `dropped` record says how many.
+//
+// JSON Lines, one object per line:
+//   {"type":"watch","mono_ns":..,"wall_ns":..,"interval_ms":2000,"commands":["date","df -h"]}
+//   {"type":"start","cmd":0,"round":1,"mono_ns":..,"wall_ns":..,"jitter_ns":..}
+//   {"type":"output","cmd":0,"round":1,"mono_ns":..,"wall_ns":..,"bytes":6,"data":"hello\n"}
+//   {"type":"end","cmd":0,"round":1,"mono_ns":..,"wall_ns":..,"outcome":"exit","status":0,"runtime_ns":..}
+//   {"type":"dropped","mono_ns":..,"wall_ns":..,"records":12}
+// `outcome` is exit, timeout, killed or failed; `status` is the exit status (128 + n
+// for signal n) and -1 for the others. Output that is not valid UTF-8 has U+FFFD in
+// place of the bad bytes; the binary format keeps every byte.
+//
+// Binary: the file starts with the 8 bytes "MWLOG001", then records of a 48-byte
+// header and a payload, all fields little-endian:
+//    0 u8  type (1 watch, 2 start, 3 output, 4 end, 5 dropped)
+//    1 u8  outcome (end: 0 exit, 1 timeout, 2 killed, 3 failed)
+//    2 u16 zero
+//    4 u32 command index
+//    8 u64 round
+//   16 i64 monotonic ns
+//   24 i64 wall-clock ns (since the epoch)
+//   32 i64 watch: interval ms; start: jitter ns; end: runtime ns; dropped: records
+//   40 i32 end: exit status
+//   44 u32 payload bytes: output: the chunk; watch: the commands, each NUL-terminated
+class WatchLog {
+public:
+    enum class Format { JsonLines, Binary };
+    enum class Outcome : uint8_t { Exit = 0, Timeout = 1, Killed = 2, Failed = 3 };
+
+    WatchLog() = default;
+    ~WatchLog() { close(); }
+    WatchLog(const WatchLog&) = delete;
+    WatchLog& operator=(const WatchLog&) = delete;
+
+    // Open (append to) `path` and start the writer; false with a message in `error`
+    bool open(const std::string& path, Format format, std::string& error);
+    bool isOpen() const { return fd_ >= 0; }
+    // Write out everything posted so far, stop the writer and close the file
+    void close();
+
+    // Watch loop side
+    void watch(const std::vector<std::string>& commands, long long intervalMs);
+    void start(size_t cmd, uint64_t round, int64_t jitterNs);
+    void output(size_t cmd, uint64_t round, const char* p, size_t n);
+    void end(size_t cmd, uint64_t round, Outcome outcome, int status, int64_t runtimeNs);
+
+private:
+    enum Type : uint8_t { Watch = 1, Start = 2, Output = 3, End = 4, Dropped = 5 };
+    struct Event {
+        uint8_t type = 0;
+        uint8_t outcome = 0;
+        uint32_t cmd = 0;
+        uint64_t round = 0;
+        int64_t monoNs = 0;
+        int64_t wallNs = 0;
+        int64_t value = 0;
+        int32_t status = 0;
+        std::string data;
+    };
+
+    Event& next(uint8_t type, size_t cmd, uint64_t round); // scratch_, stamped
+    void post();                                           // queue scratch_
+    void loop();
+    void encode(const Event& e);                           // onto batch_
+    void flush();
+
+    static constexpr size_t kQueueEvents = 4096;
+    static constexpr size_t kBatchBytes = 256 * 1024;
+
+    int fd_ = -1;
+    int kickFd_ = -1;                  // eventfd: events queued while the writer slept, or stopping
+    Format format_ = Format::JsonLines;
+    SpscQueue<Event> queue_{kQueueEvents};
+    Event scratch_;                    // loop side, recycled through the queue
+    std::atomic<bool> idle_{false};    // writer is (about to be) blocked on kickFd_
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> dropped_{0}; // events the loop could not queue
+    std::string batch_;                // writer side
+    std::thread thread_;
+};
+
+} // namespace myterm
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace myterm {
+
+// How a multiWatch worker running for the window frames its output: a stream of
+// records instead of text, so each byte is known to belong to one command even when
+// the commands of a round write at the same time.
+//
+//   kind (1 byte) | 3 bytes zero | command index (uint32) | length (uint32) | payload
+//
+// Begin carries the round's header line, Data whole lines of output (only the last
+// line of a round may lack its newline), Keep a uint32 count of lines that are the
+// same as at the same position in the previous round, Stats the command's summary
+// row (runtimes, exit statuses), End the note (if any) the text view would print
+// before the trailer. Report, for no command in particular, is the --stats report the
+// worker writes on its way out. Fields are in host byte order; both ends are the
+// same program.
+enum class WatchRecord : uint8_t { Begin = 1, Data = 2, End = 3, Keep = 4, Stats = 5, Report = 6 };
+constexpr size_t kWatchRecordHeader = 12;
+
+// Per-command panes of a running multiWatch, fed from the record stream.
+//
+// A pane shows the output of its command's last finished round; the round in
+// progress accumulates out of sight and replaces it at End. Its title (the header
+// line) and its content are versioned separately: content that comes out the same
+// as last round does not count as a change, so a view can leave the pane alone.
+// Kept lines are taken over from the pane; with highlighting, lines sent again are
+// marked as changed (except in the first round, which has nothing to differ from).
+class WatchPanes {
+public:
+    struct Pane {
+        std::string command;
+        std::string title;               // header of the round shown
+        std::vector<std::string> lines;  // its output, control sequences removed
+        std::vector<uint8_t> changed;    // per line, 1 if it differs from the round before; empty without highlighting
+        bool truncated = false;          // output beyond kMaxPaneBytes was dropped
+        std::string stats;               // summary row
+        uint64_t titleVersion = 0;
+        uint64_t contentVersion = 0;
+        uint64_t statsVersion = 0;
+    };
+
+    static constexpr size_t kMaxPaneBytes = 256 * 1024; // per round and pane
+
+    void reset(const std::vector<std::string>& commands, bool highlight = false);
+    void clear();
+    // Consume worker output; returns true if any pane's title or content changed
+    bool feed(const char* data, size_t n);
+    const std::vector<Pane>& panes() const { return panes_; }
+    // The worker's --stats report, once it has come
+    const std::string& report() const { return report_; }
+
+private:
+    struct Round {
+        std::string title;
+        std::string stats;
+        std::vector<std::string> lines;
+        std::vector<uint8_t> changed;
+        size_t count = 0;       // lines so far, including those past the byte cap
+        size_t bytes = 0;
+        bool open = false;      // last line still waiting for its newline
+        bool truncated = false;
+        bool seen = false;      // a round has ended before
+        size_t shown = 0;       // lines of the pane that are output (the note follows them)
+    };
+    void addLines(Round& r, const char* p, size_t n, uint8_t changed);
+    bool apply(WatchRecord kind, uint32_t cmd, const char* p, size_t n);
+
+    std::vector<Pane> panes_;
+    std::vector<Round> rounds_; // in progress, per pane
+    bool highlight_ = false;
+    std::string buf_;           // partial record
+    std::string report_;
+};
+
+} // namespace myterm
@@ -0,0 +1,49 @@
+#pragma once
+#include <X11/Xlib.h>
+#ifdef USE_PANGO_CAIRO
+#include <cairo/cairo-xlib.h>
+#endif
+
+namespace myterm {
+
+// Off-screen frame the window is drawn into before being copied to the screen.
+//
+// The pixmap, its GC and (with Pango) one cairo surface and context live as
+// long as the window. A resize only swaps in a pixmap of the new size: the
+// cairo surface is retargeted in place, so the cairo_t and any PangoLayout
+// created from it stay valid. Drawing a frame allocates nothing on the server.
+class BackBuffer {
+public:
+    BackBuffer() = default;
+    ~BackBuffer() { release(); }
+    BackBuffer(const BackBuffer&) = delete;
+    BackBuffer& operator=(const BackBuffer&) = delete;
+
+    // Make the buffer w x h for `win`; a no-op unless the size changed. True if reallocated.
+    bool resize(Display* dpy, Window win, int w, int h, Font font);
+    void release();
+
+    bool valid() const { return pixmap_ != None; }
+    int width() const { return w_; }
+    int height() const { return h_; }
+    Pixmap pixmap() const { return pixmap_; }
+    GC gc() const { return gc_; }
+#ifdef USE_PANGO_CAIRO
+    cairo_t* cairo() const { return cr_; }
+#endif
+
+    // Copy a region of the frame (default: all of it) to the same place in `win`.
+    void present(Window win, GC gc, int x = 0, int y = 0, int w = -1, int h = -1);
+
+private:
+    Display* dpy_ = nullptr;
+    Pixmap pixmap_ = None;
+    GC gc_ = nullptr;
+    int w_ = 0, h_ = 0;
+#ifdef USE_PANGO_CAIRO
+    cairo_surface_t* surface_ = nullptr;
+    cairo_t* cr_ = nullptr;
+#endif
+};
+
+} // namespace myterm
@@ -0,0 +1,62 @@
+#pragma once
+#ifdef USE_PANGO_CAIRO
+#include <cairo/cairo.h>
+#include <pango/pangocairo.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace myterm {
+
+// Rasterized grapheme clusters for the Pango render path.
+//
+// Each (cluster, bold/italic) pair is shaped and rendered once into an A8 mask
+// the size of one terminal cell, with the glyph centered and clipped to the
+// cell the way the direct path did it. Drawing is then a single
+// cairo_mask_surface() in whatever color is current. Entries are kept in LRU
+// order and the oldest are dropped once the masks exceed the memory budget.
+class GlyphAtlas {
+public:
+    static constexpr uint8_t kBold = 1, kItalic = 2;
+
+    explicit GlyphAtlas(size_t budgetBytes) : budget_(budgetBytes) {}
+    ~GlyphAtlas() { clear(); }
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    // Cell box the masks are cut to: width, and the ascent/descent of the font.
+    // Changing it (or the font) drops every entry.
+    void configure(int cellW, int ascent, int descent);
+    void setBudget(size_t bytes);
+    void clear();
+
+    // Mask of `cluster` (nullptr for clusters without ink, e.g. a space). Rendered
+    // with `layout` on a miss; the layout's text and font are left changed.
+    // The mask's top-left goes at (cell x, baseline - ascent - 1).
+    cairo_surface_t* lookup(PangoLayout* layout, const PangoFontDescription* font, std::string_view cluster, uint8_t style);
+
+    size_t bytes() const { return bytes_; }
+    size_t size() const { return map_.size(); }
+
+private:
+    struct Entry {
+        std::string key;
+        cairo_surface_t* mask; // nullptr: nothing to draw
+        size_t bytes;
+    };
+
+    void evict();
+
+    std::list<Entry> lru_; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> map_;
+    std::string probe_; // scratch lookup key
+    size_t budget_;
+    size_t bytes_ = 0;
+    int cellW_ = 0, ascent_ = 0, descent_ = 0;
+};
+
+} // namespace myterm
+#endif
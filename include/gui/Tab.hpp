@@ -1,24 +1,33 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <deque>
 #include <utility>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <vector>
+#include "core/Job.hpp"
+#include "core/ScrollbackStore.hpp"
+#include "core/ShellParser.hpp"
+#include "core/VtScreen.hpp"
+#include "core/WatchPanes.hpp"
+#include "gui/WrapCache.hpp"
 
 namespace myterm {
 
-struct BackgroundJob {
-    pid_t pid;
-    pid_t pgid;
-    int outFd;
-    int errFd;
-    std::string cmd;
-    bool isPty = false; // true when outFd refers to a PTY master (interactive job)
+// A pipeline waiting for the tab's current job to finish
+struct PendingCommand {
+    Pipeline pipeline;
+    std::string echo; // shown after a prompt when it starts; empty for typed input, which is already echoed
 };
 
 class Tab {
 public:
-    std::string scrollback; // accumulated output
+    Tab() = default;
+    Tab(size_t maxLines, size_t maxBytes) : scrollback(maxLines, maxBytes) {}
+
+    ScrollbackStore scrollback; // accumulated output (line/byte limits are per tab: `scrollback` builtin)
+    WrapCache wrap;             // soft-wrap rows of `scrollback` at the window width
     std::string input;      // current line
     size_t cursor = 0;      // cursor index
     int scrollOffsetLines = 0; // number of lines scrolled up from bottom
@@ -34,10 +43,13 @@ public:
     int outFd = -1;      // stdout pipe read end
     int errFd = -1;      // stderr pipe read end
     int inFdWrite = -1;  // stdin pipe write end (from terminal to child)
+    pid_t childExitedPid = -1; // childPid once it has been reaped, until its output has drained
+    int lastExitStatus = 0;     // wait status and resource usage of the last foreground job
+    struct rusage lastUsage{};
 
-    // ANSI parsing state (for chunked reads)
-    enum { ANSI_TEXT=0, ANSI_ESC=1, ANSI_CSI=2 } ansiState = ANSI_TEXT;
-    std::string ansiSeq;
+    // Terminal emulation of child output: edits the scrollback's last line in place,
+    // or a separate cell grid while a full-screen program uses the alternate screen
+    VtScreen vt{scrollback};
 
     // Continuation input state (for unmatched quotes)
     bool contActive = false;        // true when waiting for closing quote
@@ -47,16 +59,18 @@ public:
     // but keep this for potential UI decisions.
     bool contJoinNoNewline = false;
 
-    // Queue of pending commands to execute sequentially: pair<cmd, echoPromptAndCmd>
-    std::deque<std::pair<std::string,bool>> pendingCmds;
+    // Queue of parsed pipelines to execute sequentially
+    std::deque<PendingCommand> pendingCmds;
 
     std::vector<BackgroundJob> backgroundJobs;
 
-    // multiWatch state: save/restore original terminal content
+    // multiWatch state: while it runs the text area shows its panes instead of the
+    // scrollback, which is left as it was
     bool watchActive = false;                 // true while multiWatch is running
-    std::string savedScrollbackBeforeWatch;   // previous scrollback to restore on completion
+    WatchPanes watch;                         // its panes, fed by the worker's records
 
-    void appendOutput(const std::string& s, size_t cap = 1<<20);
+    void appendOutput(std::string_view s);
+    void appendOutput(const StyledText& s);
 };
 
 } // namespace myterm
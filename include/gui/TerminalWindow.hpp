@@ -4,10 +4,21 @@
 #include <cairo/cairo-xlib.h>
 #include <pango/pangocairo.h>
 #endif
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <memory>
+#include "core/ChildReaper.hpp"
+#include "core/CommandIndex.hpp"
 #include "core/History.hpp"
+#include "core/IoThread.hpp"
+#include "core/Reactor.hpp"
+#include "core/ShellParser.hpp"
+#include "core/TextStyle.hpp"
+#include "gui/BackBuffer.hpp"
+#include "gui/GlyphAtlas.hpp"
 
 namespace myterm {
 
@@ -23,6 +34,7 @@ public:
     TerminalWindow& operator=(const TerminalWindow&) = delete;
 
     void run(); // event loop
+    void setFrameRate(int hz); // upper bound on frames rendered per second (default 60)
 
     // For future: API to add tabs, etc.
     void newTab();
@@ -34,7 +46,10 @@ private:
     void selectFont();
     void initHistory();
     void addHistoryEntry(const std::string& cmd);
-    void redraw();
+    // Producers only mark the window dirty; run() renders at most one frame per frame
+    // interval. Frames requested by child output alone are deferred further while it floods.
+    void requestFrame(bool fromOutput = false);
+    void renderFrame();
     void drawTabBar();
     void drawTextArea();
     void drawScrollBar(int totalLines, int viewportLines, int beginLine);
@@ -43,8 +58,16 @@ private:
     void handleMotion(XMotionEvent* e);
     void handleButtonRelease(XButtonEvent* e);
     void drawColoredPromptLine(int x, int y, const std::string& line);
-    void drawMaybeColoredPromptLine(int x, int y, const std::string& line, bool gridMode=false);
-    void drawAnsiTextWithParsing(int x, int y, const std::string& text);
+    void drawMaybeColoredPromptLine(int x, int y, const std::string& line, bool gridMode=false, const std::vector<StyleRun>* runs=nullptr);
+    void drawStyledText(int x, int y, const std::string& text, const std::vector<StyleRun>* runs, size_t base, bool cellAligned = false);
+    void drawAltScreen(Tab& t);
+    void drawWatchPanes(Tab& t);
+    bool paintRows(int slots, int used, bool scrollBar);
+    void updateCaret();
+    int rowAscent() const;
+    int rowDescent() const;
+    int rowTop(int slot) const;
+    void addDamage(int y0, int y1);
     // Clipboard / paste
     void requestPaste(Atom selection);
     void handleSelectionNotify(XSelectionEvent* e);
@@ -57,14 +80,16 @@ private:
     void autocomplete(Tab& t);
     // Command execution
     void executeLine(const std::string& line);
-    void executeLineInternal(const std::string& line, bool echoPromptAndCmd);
-    void printPromptForCurrentTab(bool continuation);
-    void spawnProcess(const std::vector<std::string>& argv);
-    void pumpChildOutput();
-    void drainBackgroundJobs();
-    static std::vector<std::string> splitArgs(const std::string& s);
+    void executePipeline(Tab& t, const Pipeline& p, const std::string& echo);
+    void printPrompt(Tab& t, bool continuation);
+    void spawnProcess(Tab& t, const std::vector<std::string>& argv);
+    bool pumpChildOutput();
+    void handleChildExits();
+    void reapChildren(Tab& t);
+    void closeChildFd(int& fd);
+    bool isShown(const Tab& t) const; // t is the active tab
     static bool isWhitespaceOnly(const std::string& s);
-    std::string sanitizeAndApplyANSI(struct Tab& t, const char* data, size_t n);
+    void applyTerminalOutput(struct Tab& t, const char* data, size_t n, int replyFd);
 
     // ANSI color helpers
     unsigned long ansiColorToPixel(int code, bool fg) const;
@@ -73,14 +98,21 @@ private:
     int measureTextWidth(const std::string& text);
 
 #ifdef USE_PANGO_CAIRO
-    void ensureCairoSurface();
+    void ensureCairoSurface(); // back buffer context, layout, font and metrics (created once)
     void destroyCairoObjects();
     void drawTextPango(int x, int y, const std::string& utf8, unsigned long fgPixel);
+    int drawClusters(int x, int y, const std::string& safeUtf8, uint8_t style); // one cell per cluster; returns clusters
+    void setSourcePixel(unsigned long pixel, double alpha = 1.0);
     int measureTextPango(const std::string& utf8);
 #endif
 
     // Helpers
     int charWidth() const;
+    bool ensureBackBuffer(); // (re)allocate back_ when the window size changed; true if it was
+    int wrapColumns() const; // soft-wrap width of the text area in cells
+    int viewportRows() const; // text rows that fit below the tab bar
+    void resizeTerminal(Tab& t); // size the tab's emulator (and its PTY job) to the window
+    void segmentLine(std::string_view line, std::vector<uint32_t>& bounds);
     // Persistent history
     History history_{};
     std::string historyPath_{};
@@ -97,12 +129,14 @@ private:
     size_t acReplaceStart_ = 0;
     size_t acReplaceEnd_ = 0;
     std::string acDirPrefix_{}; // token directory prefix to keep when replacing
-    size_t acScrollbackMark_ = (size_t)-1; // start offset in scrollback to erase choices
+    bool acCommands_ = false;   // choices are command names rather than files
+    size_t acScrollbackMark_ = (size_t)-1; // absolute scrollback offset (ScrollbackStore::endOffset) to erase choices
 
     Display* dpy_ = nullptr;
     int screen_ = 0;
     Window win_{};
     GC gc_{};
+    BackBuffer back_; // frame being drawn; win_/gc_ point at it during renderFrame()
     XFontStruct* font_ = nullptr;
     Colormap cmap_{};
 
@@ -112,15 +146,16 @@ private:
 
 #ifdef USE_PANGO_CAIRO
     // Pango/Cairo for Unicode text rendering
-    cairo_surface_t* cairoSurface_ = nullptr;
-    cairo_t* cr_ = nullptr;
+    cairo_t* cr_ = nullptr; // back buffer's context (owned by back_)
     PangoLayout* pangoLayout_ = nullptr;
     PangoFontDescription* pangoFontDesc_ = nullptr;
-    int cairoW_ = 0, cairoH_ = 0; // cached surface size
     int cellW_ = 8; // width of one cell measured via Pango (monospace)
     // Pango-derived metrics (pixels)
     int pangoAscent_ = 0;
     int pangoDescent_ = 0;
+    static constexpr size_t kGlyphCacheBytes = 8u << 20; // memory budget of the cluster masks
+    GlyphAtlas glyphs_{kGlyphCacheBytes};
+    std::vector<std::pair<unsigned long, uint32_t>> pixelRgb_; // X pixel -> 0xRRGGBB, saves a server round trip per draw
 #else
     int cellW_ = 8;
 #endif
@@ -145,6 +180,7 @@ private:
         unsigned long scrollThumbHover = 0; // thumb hover color
         unsigned long tabHoverBg = 0; // hover color for tabs
         unsigned long newTabBg = 0; // color for new tab button
+        unsigned long changedBg = 0; // multiWatch -d: lines that changed since the last round
         std::vector<unsigned long> ansiFgColors;
         std::vector<unsigned long> ansiBgColors;
     } theme_{};
@@ -167,17 +203,92 @@ private:
 
     std::vector<std::unique_ptr<Tab>> tabs_;
     int activeTab_ = 0;
+    // Scrollback limits of new tabs: MYTERM_SCROLLBACK_LINES / MYTERM_SCROLLBACK_BYTES (0 = unlimited)
+    size_t scrollbackLines_ = 0;
+    size_t scrollbackBytes_ = 0;
 
     bool cursorOn_ = true;
     // Blink timing
     int blinkMs_ = 600;
-    int blinkCountdownMs_ = 600;
-    int tickMs_ = 16; // ~60 FPS for smooth animations
-    unsigned long long lastBlinkMs_ = 0; // monotonic ms at last update
+    static constexpr size_t kReflowSlice = 4096; // lines re-wrapped per loop iteration after a resize
+
+    // Event loop
+    Reactor reactor_;
+    TimerFd blinkTimer_;  // caret blink, armed while focused
+    TimerFd frameTimer_;  // fires when the next scheduled frame is due
+    unsigned long long frameTimerUs_ = 0; // deadline frameTimer_ is armed for (0: none)
+    void restartBlink(); // show the caret and start a new blink period
+
+    // Executables on PATH, shared by exec and completion
+    CommandIndex commands_;
+
+    // Child exits; declared before io_ since it may have to block SIGCHLD before any thread starts
+    ChildReaper reaper_;
+    // Child output of every tab is read on io_'s thread and applied here in slices
+    IoThread io_;
+    IoThread::Chunk ioChunk_;  // popped chunk; its buffer goes back to the reader on the next pop
+    bool ioBacklog_ = false;   // more output queued than the last slice took
+    static constexpr size_t kIngestSlice = 1 << 20; // bytes of child output parsed per loop iteration
+
+    // Frame scheduler
+    long long frameIntervalUs_ = 1000000 / 60;
+    bool frameDue_ = false;         // something changed since the last frame
+    bool frameInteractive_ = false; // ...and it was not only child output
+    unsigned long long lastFrameUs_ = 0; // monotonic time of the last frame
+    size_t ingestedBytes_ = 0;      // child output fed to the emulators since the last frame
+    int frameSkip_ = 0;             // extra intervals the next output-only frame waits
+    static constexpr size_t kFloodBytesPerFrame = 64 * 1024; // more than this between frames is a flood
+    static constexpr int kMaxFrameSkip = 15; // a flood still shows a frame every 16 intervals
 
     // Scrollbar geometry cache for hover checks
     int lastThumbY_ = -1;
     int lastThumbH_ = 0;
+    // Line geometry of the last drawn frame (wrapped rows incl. live input), shared with
+    // the scrollbar click/drag handlers so they never rescan the scrollback
+    int lastTotalLines_ = 0;
+    int lastViewportLines_ = 1;
+    int lastBeginLine_ = 0;
+
+    // Damage tracking. The back buffer keeps the last frame; each part records a key of
+    // what it shows so renderFrame() repaints only parts whose key changed.
+    struct FrameRow {
+        std::string text;
+        std::vector<StyleRun> runs;
+        int x = 10;
+        bool styled = false; // runs apply (scrollback and alternate-screen rows)
+        bool grid = false;   // live prompt/input row
+        bool cells = false;  // alternate-screen row: one cell per code point
+    };
+    struct Caret {
+        int x = 0, y = 0, w = 0, h = 0;
+        bool outline = false; // block outline (alternate screen) instead of a bar
+        bool valid = false;
+    };
+    std::vector<FrameRow> frameRows_;  // rows of the frame being built
+    std::vector<uint64_t> rowKeys_;    // content key of each row band in the back buffer
+    std::vector<uint64_t> nextKeys_;   // scratch: keys of frameRows_
+    uint64_t tabBarKey_ = 0;
+    uint64_t scrollBarKey_ = 0;
+    bool scrollBarShown_ = false;
+    bool scrollBarDamaged_ = false;    // scrollbar column must be presented
+    bool frameValid_ = false;          // back buffer holds a complete frame
+    int damageY0_ = 0, damageY1_ = 0;  // band of the back buffer repainted by this renderFrame()
+    Caret caret_;                      // where the caret belongs in the current frame
+    Caret caretShown_;                 // caret currently drawn on the window
+
+    // multiWatch pane grid. Each pane is laid out (rows cut to its size) only when its
+    // content version or its rectangle changes, and its title and body are repainted
+    // only when their keys differ from what the back buffer shows.
+    struct PaneView {
+        int x = 0, y = 0, w = 0, h = 0;      // rectangle in the text area, border included
+        uint64_t laidOut = ~0ull;             // content version `rows` were cut from
+        std::vector<std::string> rows;        // body rows clipped to the pane
+        std::vector<uint8_t> changed;         // per row, highlighted as changed
+        uint64_t titleKey = 0, bodyKey = 0, footKey = 0; // what the back buffer shows (0: unknown)
+    };
+    std::vector<PaneView> paneViews_;
+    const Tab* paneTab_ = nullptr;     // tab paneViews_ belong to
+    bool panesShown_ = false;          // the text area shows a pane grid
 };
 
 } // namespace myterm
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "core/ScrollbackStore.hpp"
+
+namespace myterm {
+
+// Soft-wrap state for a tab's scrollback: per logical line, the grapheme
+// boundaries (computed once when the line arrives or changes) and the number
+// of wrapped rows at the current column width.
+//
+// Boundaries do not depend on the width, so a resize only has to recompute row
+// counts. setColumns() marks every entry stale; reflowVisible() re-wraps the
+// newest lines until the viewport is covered and reflowStep() works through the
+// rest in small slices from the event loop.
+//
+// Row counts are also kept in a Fenwick tree indexed by absolute line number, so
+// locate() maps a wrapped row to (line, row within line) in O(log n) and the
+// viewport never has to walk the scrollback.
+class WrapCache {
+public:
+    // Fills `bounds` with the byte offsets of grapheme starts plus the line length.
+    // Only called for lines that contain non-ASCII bytes.
+    using Segmenter = std::function<void(std::string_view line, std::vector<uint32_t>& bounds)>;
+
+    void setColumns(int cols);
+    int columns() const { return cols_; }
+
+    // Catch up with the store: drop evicted lines, re-segment lines changed in
+    // place and segment lines appended since the last call.
+    void sync(ScrollbackStore& store, const Segmenter& seg);
+
+    // Lines currently tracked; equals store.lineCount() after sync().
+    size_t lineCount() const { return entries_.size(); }
+    // Wrapped rows of line i (relative to the store's line(0)) at the current width.
+    int rows(size_t i);
+    // Sum of rows over all lines; entries not yet reflowed count at their old width.
+    size_t totalRows() const { return totalRows_; }
+    // Line (relative to line(0)) holding wrapped row `row` (< totalRows()), and the row within it.
+    std::pair<size_t, int> locate(size_t row) const;
+    // Byte range [first, second) of wrapped row `row` within line i.
+    std::pair<size_t, size_t> rowRange(size_t i, int row);
+    // Text of wrapped row `row` of line i, as a view into the store.
+    std::string_view rowText(const ScrollbackStore& store, size_t i, int row);
+
+    // Re-wrap up to `budget` stale lines; returns true while stale lines remain.
+    bool reflowStep(size_t budget);
+    bool reflowPending() const { return reflowPending_; }
+    // Re-wrap stale lines newest-first until the last `rows` wrapped rows are all current.
+    void reflowVisible(size_t rows);
+
+private:
+    struct Entry {
+        std::vector<uint32_t> bounds; // empty: one grapheme per byte (ASCII)
+        uint32_t graphemes = 0;
+        uint32_t rows = 0;
+        int cols = 0; // width `rows` was computed for
+    };
+
+    void segment(Entry& e, std::string_view line, const Segmenter& seg);
+    void refresh(size_t i);
+    void dropFront();
+    void dropBack();
+    void reset(size_t first);
+
+    // Fenwick tree over rows, slot k = absolute line treeBase_ + k (1-based inside tree_)
+    void treeAdd(size_t absLine, int64_t delta);
+    size_t treePrefix(size_t absLine) const; // rows of lines [treeBase_, absLine)
+    void treeRebuild();
+
+    std::deque<Entry> entries_;
+    size_t first_ = 0; // absolute line number of entries_.front()
+    size_t totalRows_ = 0;
+    int cols_ = 80;
+    bool reflowPending_ = false;
+    size_t reflowNext_ = 0; // absolute line number below which the reflow still has to look
+    std::vector<uint32_t> scratch_;
+    std::vector<size_t> tree_;
+    size_t treeBase_ = 0;
+};
+
+} // namespace myterm
@@ -1,20 +1,20 @@
+#include "core/Shell.hpp"
 #include "gui/TerminalWindow.hpp"
-#include <glob.h>
-#include <unistd.h>
+#include <cstdio>
 #include <cstring>
 
-static void sweep_on_exit() {
-    glob_t gb; memset(&gb, 0, sizeof(gb));
-    if (glob("temp/.temp.*.txt", 0, nullptr, &gb) == 0) {
-        for (size_t i=0; i<gb.gl_pathc; ++i) {
-            unlink(gb.gl_pathv[i]);
+// myshell                 the terminal window
+// myshell -c 'commands'   run commands without a display, output to stdout
+// myshell script.sh       run a script the same way
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        myterm::Shell shell;
+        if (strcmp(argv[1], "-c") == 0) {
+            if (argc < 3) { fprintf(stderr, "myshell: -c: option requires an argument\n"); return 2; }
+            return shell.run(argv[2]);
         }
+        return shell.runFile(argv[1]);
     }
-    globfree(&gb);
-}
-
-int main() {
-    atexit(sweep_on_exit);
     myterm::TerminalWindow app(1000, 700);
     app.run();
     return 0;
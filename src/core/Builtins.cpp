@@ -0,0 +1,173 @@
+#include "core/Builtins.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace myterm {
+
+// echo: interpret C-like escapes when quoted input contains them
+static void echo(const std::vector<std::string>& args, std::string& out) {
+    std::string payload;
+    for (size_t i=1;i<args.size();++i){ if(i>1) payload.push_back(' '); payload += args[i]; }
+    // Unescape sequences: \n, \t, \\ and \"\' inside quoted forms
+    for (size_t i=0;i<payload.size(); ++i) {
+        char c = payload[i];
+        if (c=='\\' && i+1<payload.size()) {
+            char n = payload[i+1];
+            // remove a backslash that was used as line continuation before a literal newline from transcript
+            if (n=='\n') { ++i; continue; }
+            if (n=='n') { out.push_back('\n'); ++i; continue; }
+            if (n=='t') { out.append("    "); ++i; continue; }
+            if (n=='\"') { out.push_back('"'); ++i; continue; }
+            if (n=='\'') { out.push_back('\''); ++i; continue; }
+            if (n=='\\') { out.push_back('\\'); ++i; continue; }
+        }
+        out.push_back(c);
+    }
+    out.push_back('\n');
+}
+
+static int history(ShellContext& ctx, const std::vector<std::string>& args, std::string& out) {
+    // Clear history: history -c | history --clear | history clear
+    if (args.size()>=2 && (args[1]=="-c" || args[1]=="--clear" || args[1]=="clear")) {
+        ctx.history.clear();
+        // Truncate file to empty
+        if (!ctx.historyPath.empty()) ctx.history.saveToFile(ctx.historyPath);
+        out += "History cleared\n";
+        return 0;
+    }
+    // Default: print last 1000 commands
+    const auto& dq = ctx.history.data();
+    int count = (int)dq.size();
+    int start = std::max(0, count - 1000);
+    for (int i=start;i<count;++i) { out += dq[i]; out.push_back('\n'); }
+    return 0;
+}
+
+static int cd(const std::vector<std::string>& args, std::string& err) {
+    const char* home = getenv("HOME");
+    std::string target = home ? home : "/";
+    if (args.size()>=2 && args[1].size() && args[1][0]=='~') target += args[1].substr(1);
+    else if (args.size()>=2) target = args[1];
+    if (chdir(target.c_str())!=0) {
+        err += "cd: no such file or directory\n";
+        return 1;
+    }
+    return 0;
+}
+
+// hash [-r] [name ...] (the PATH command index)
+static int hash(ShellContext& ctx, const std::vector<std::string>& args, std::string& out, std::string& err) {
+    int status = 0;
+    if (args.size()>=2 && args[1]=="-r") {
+        ctx.commands.rehash();
+    } else if (args.size()>=2) {
+        for (size_t i=1;i<args.size();++i) {
+            if (args[i].find('/')==std::string::npos && !ctx.commands.lookup(args[i])) {
+                err += "hash: " + args[i] + ": not found\n";
+                status = 1;
+            }
+        }
+    } else {
+        auto seen = ctx.commands.remembered();
+        if (seen.empty()) out += "hash: hash table empty\n";
+        else out += "hits\tcommand\n";
+        for (auto& kv : seen) {
+            std::string hits = std::to_string(kv.second->hits);
+            if (hits.size()<4) hits.insert(0, 4-hits.size(), ' ');
+            out += hits + "\t" + kv.second->path + "\n";
+        }
+    }
+    return status;
+}
+
+// bgpids: list background pids with commands
+static int bgpids(ShellContext& ctx, std::string& out) {
+    if (ctx.jobs.empty()) {
+        out += "No background jobs\n";
+        return 0;
+    }
+    for (const auto &job : ctx.jobs) {
+        out += "PID=" + std::to_string(job.pid) +
+               (job.pgid>0? (" PGID=" + std::to_string(job.pgid)) : std::string("")) +
+               " CMD=" + job.cmd + "\n";
+    }
+    return 0;
+}
+
+static void close_job_fd(ShellContext& ctx, int& fd) {
+    if (fd < 0) return;
+    if (ctx.closeFd) { ctx.closeFd(fd); return; }
+    close(fd);
+    fd = -1;
+}
+
+// kill / killprocess [-9] PID [PID...]: a background job's whole process group when
+// the pid is one of ours
+static int kill_pids(ShellContext& ctx, const std::vector<std::string>& args, std::string& out, std::string& err) {
+    const std::string& name = args[0];
+    int sig = SIGTERM;
+    size_t i = 1;
+    if (args.size()>=2 && args[1].size()>1 && args[1][0]=='-' ) {
+        if (args[1] == "-9") sig = SIGKILL;
+        else if (args[1] == "-15") sig = SIGTERM;
+        ++i;
+    }
+    if (i>=args.size()) { err += "usage: " + name + " [-9] PID [PID ...]\n"; return 2; }
+    int status = 0;
+    for (; i<args.size(); ++i) {
+        const std::string &spid = args[i];
+        char *end=nullptr; long v = strtol(spid.c_str(), &end, 10);
+        if (spid.empty() || !end || *end!='\0' || v<=0) {
+            err += name + ": invalid pid '" + spid + "'\n";
+            status = 1;
+            continue;
+        }
+        pid_t pid = (pid_t)v;
+        auto it = std::find_if(ctx.jobs.begin(), ctx.jobs.end(),
+                               [&](const BackgroundJob& j) { return j.pid == pid || j.pgid == pid; });
+        if (it != ctx.jobs.end() && it->pgid > 0) {
+            if (killpg(it->pgid, sig) == 0) {
+                out += "killed process group " + std::to_string(it->pgid) + " (sig " + std::to_string(sig) + ")\n";
+            } else {
+                err += "killpg(" + std::to_string(it->pgid) + ") failed: " + std::string(strerror(errno)) + "\n";
+                status = 1;
+            }
+        } else {
+            // Not one of ours (or in no group of its own): a direct kill
+            pid_t target = it != ctx.jobs.end() ? it->pid : pid;
+            if (kill(target, sig) == 0) {
+                out += "killed pid " + std::to_string(target) + " (sig " + std::to_string(sig) + ")\n";
+            } else {
+                err += "kill(" + std::to_string(target) + ") failed: " + std::string(strerror(errno)) + "\n";
+                status = 1;
+            }
+        }
+        if (it != ctx.jobs.end()) {
+            close_job_fd(ctx, it->outFd);
+            close_job_fd(ctx, it->errFd);
+            ctx.jobs.erase(it);
+        }
+    }
+    return status;
+}
+
+bool runBuiltin(ShellContext& ctx, const std::vector<std::string>& args,
+                std::string& out, std::string& err, int& status) {
+    if (args.empty()) return false;
+    const std::string& name = args[0];
+    if (name == "echo") { echo(args, out); status = 0; }
+    else if (name == "history") status = history(ctx, args, out);
+    else if (name == "cd") status = cd(args, err);
+    else if (name == "hash") status = hash(ctx, args, out, err);
+    else if (name == "bgpids") status = bgpids(ctx, out);
+    else if (name == "kill" || name == "killprocess") status = kill_pids(ctx, args, out, err);
+    else return false;
+    return true;
+}
+
+} // namespace myterm
@@ -0,0 +1,97 @@
+#include "core/ChildReaper.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+namespace myterm {
+
+static int pidfd_open(pid_t pid) {
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+static void add_to(int epfd, int fd) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+// Children start with the signal mask of the forking thread: give them SIGCHLD back
+static void unblock_sigchld_in_child() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_UNBLOCK, &set, nullptr);
+}
+
+ChildReaper::ChildReaper() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    kickFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    add_to(epfd_, kickFd_);
+    int probe = pidfd_open(getpid());
+    if (probe >= 0) {
+        close(probe);
+        return;
+    }
+    // No pidfds (before Linux 5.3): take SIGCHLD through a signalfd
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    pthread_atfork(nullptr, nullptr, unblock_sigchld_in_child);
+    sigFd_ = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    add_to(epfd_, sigFd_);
+}
+
+ChildReaper::~ChildReaper() {
+    for (auto& c : children_) if (c.second >= 0) close(c.second);
+    if (sigFd_ >= 0) close(sigFd_);
+    close(kickFd_);
+    close(epfd_);
+}
+
+void ChildReaper::track(pid_t pid) {
+    if (pid <= 0) return;
+    int pfd = sigFd_ < 0 ? pidfd_open(pid) : -1;
+    if (pfd >= 0) {
+        add_to(epfd_, pfd); // pidfds are always close-on-exec
+    } else {
+        // Its SIGCHLD may already have been consumed: look at it on the next collect()
+        uint64_t one = 1;
+        (void)!write(kickFd_, &one, sizeof one);
+    }
+    children_.emplace_back(pid, pfd);
+}
+
+void ChildReaper::collect(std::vector<Exit>& out) {
+    uint64_t n;
+    (void)!read(kickFd_, &n, sizeof n);
+    if (sigFd_ >= 0) {
+        signalfd_siginfo si;
+        while (read(sigFd_, &si, sizeof si) == (ssize_t)sizeof si) {}
+    }
+    for (size_t i = 0; i < children_.size(); ) {
+        Exit e{};
+        e.pid = children_[i].first;
+        pid_t r = wait4(e.pid, &e.status, WNOHANG, &e.usage);
+        if (r == 0 || (r < 0 && errno == EINTR)) { ++i; continue; }
+        // Reaped (or not ours to wait for any more). Closing the pidfd also drops it from the epoll set
+        if (children_[i].second >= 0) close(children_[i].second);
+        children_[i] = children_.back();
+        children_.pop_back();
+        if (r == e.pid) out.push_back(e);
+    }
+}
+
+} // namespace myterm
@@ -0,0 +1,150 @@
+#include "core/CommandIndex.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace myterm {
+
+static const uint32_t kDirEvents = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |
+                                   IN_DELETE_SELF | IN_MOVE_SELF;
+
+CommandIndex::CommandIndex() {
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+CommandIndex::~CommandIndex() {
+    if (inotifyFd_ >= 0) close(inotifyFd_);
+}
+
+void CommandIndex::handleEvents() {
+    if (inotifyFd_ < 0) return;
+    alignas(inotify_event) char buf[4096];
+    ssize_t n;
+    while ((n = read(inotifyFd_, buf, sizeof buf)) > 0) {
+        for (ssize_t off = 0; off < n; ) {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(buf + off);
+            off += (ssize_t)(sizeof(inotify_event) + ev->len);
+            if (ev->mask & IN_Q_OVERFLOW) { stale_ = true; continue; }
+            bool current = false;
+            for (auto it = watches_.begin(); it != watches_.end(); ) {
+                if (it->second != ev->wd) { ++it; continue; }
+                current = true;
+                // The kernel dropped it (directory deleted or unmounted): watch again after the rescan
+                if (ev->mask & IN_IGNORED) it = watches_.erase(it);
+                else ++it;
+            }
+            // Watches scan() dropped report IN_IGNORED once more; those are no news
+            if (current) stale_ = true;
+        }
+    }
+}
+
+void CommandIndex::rehash() {
+    stale_ = true;
+    table_.clear();
+}
+
+void CommandIndex::refresh() {
+    // Changes whose events nobody has read yet (the headless shell never polls fd())
+    handleEvents();
+    const char* env = getenv("PATH");
+    std::string path = env ? env : "/usr/local/bin:/usr/bin:/bin";
+    if (path != path_) stale_ = true;
+    if (!stale_ && inotifyFd_ < 0) {
+        for (auto& d : dirs_) {
+            struct stat st{};
+            if (stat(d.first.c_str(), &st) != 0 || st.st_mtime != d.second) { stale_ = true; break; }
+        }
+    }
+    if (!stale_) return;
+    path_ = path;
+    scan();
+    stale_ = false;
+}
+
+void CommandIndex::scan() {
+    std::unordered_map<std::string, unsigned> hits;
+    for (auto& kv : table_) if (kv.second.hits) hits[kv.first] = kv.second.hits;
+    table_.clear();
+    dirs_.clear();
+    ++scans_;
+    // Directories still on PATH keep their watch; the others lose it below
+    std::unordered_map<std::string, int> old;
+    old.swap(watches_);
+    size_t pos = 0;
+    while (pos <= path_.size()) {
+        size_t colon = path_.find(':', pos);
+        if (colon == std::string::npos) colon = path_.size();
+        std::string dir = path_.substr(pos, colon - pos);
+        pos = colon + 1;
+        // Relative entries depend on the cwd: those are left to the exec fallback
+        if (dir.empty() || dir[0] != '/') continue;
+        if (std::any_of(dirs_.begin(), dirs_.end(), [&](const std::pair<std::string, time_t>& d) { return d.first == dir; })) continue;
+        int dfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dfd < 0) continue;
+        struct stat dst{};
+        fstat(dfd, &dst);
+        dirs_.emplace_back(dir, dst.st_mtime);
+        auto w = old.find(dir);
+        if (w != old.end()) {
+            watches_.insert(*w);
+            old.erase(w);
+        } else if (inotifyFd_ >= 0) {
+            int wd = inotify_add_watch(inotifyFd_, dir.c_str(), kDirEvents);
+            if (wd >= 0) watches_.emplace(dir, wd);
+        }
+        DIR* d = fdopendir(dfd);
+        if (!d) { close(dfd); continue; }
+        while (dirent* ent = readdir(d)) {
+            if (ent->d_name[0] == '.') continue;
+            if (ent->d_type != DT_REG && ent->d_type != DT_LNK && ent->d_type != DT_UNKNOWN) continue;
+            // Earlier directories win, as with execvp()
+            if (table_.count(ent->d_name)) continue;
+            struct stat st{};
+            if (fstatat(dfd, ent->d_name, &st, 0) != 0) continue;
+            if (!S_ISREG(st.st_mode) || !(st.st_mode & 0111)) continue;
+            Entry& e = table_[ent->d_name];
+            e.path = dir + (dir.back() == '/' ? "" : "/") + ent->d_name;
+            e.mtime = st.st_mtime;
+            auto h = hits.find(ent->d_name);
+            if (h != hits.end()) e.hits = h->second;
+        }
+        closedir(d);
+    }
+    // A directory reached through two PATH entries (a symlink) shares one watch
+    for (auto& w : old) {
+        if (std::none_of(watches_.begin(), watches_.end(), [&](const std::pair<const std::string, int>& k) { return k.second == w.second; }))
+            inotify_rm_watch(inotifyFd_, w.second);
+    }
+}
+
+const CommandIndex::Entry* CommandIndex::lookup(const std::string& name) {
+    refresh();
+    auto it = table_.find(name);
+    if (it == table_.end()) return nullptr;
+    ++it->second.hits;
+    return &it->second;
+}
+
+std::vector<std::string> CommandIndex::complete(const std::string& prefix) {
+    refresh();
+    std::vector<std::string> out;
+    for (auto& kv : table_) if (kv.first.compare(0, prefix.size(), prefix) == 0) out.push_back(kv.first);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::vector<std::pair<std::string, const CommandIndex::Entry*>> CommandIndex::remembered() {
+    refresh();
+    std::vector<std::pair<std::string, const Entry*>> out;
+    for (auto& kv : table_) if (kv.second.hits) out.emplace_back(kv.first, &kv.second);
+    std::sort(out.begin(), out.end(),
+              [](const std::pair<std::string, const Entry*>& a, const std::pair<std::string, const Entry*>& b) { return a.first < b.first; });
+    return out;
+}
+
+} // namespace myterm
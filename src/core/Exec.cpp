@@ -0,0 +1,115 @@
+#include "core/Exec.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+
+namespace myterm {
+
+std::vector<std::string> expandWords(const std::vector<Word>& words) {
+    std::vector<std::string> argv;
+    for (const auto& w : words) {
+        if (!w.glob) { argv.push_back(w.text); continue; }
+        glob_t globbuf;
+        if (glob(w.text.c_str(), GLOB_NOCHECK | GLOB_TILDE, nullptr, &globbuf) == 0) {
+            for (size_t i = 0; i < globbuf.gl_pathc; ++i) argv.push_back(globbuf.gl_pathv[i]);
+        } else {
+            argv.push_back(w.text);
+        }
+        globfree(&globbuf);
+    }
+    return argv;
+}
+
+std::string spawnError(const std::string& cmd, int err) {
+    return cmd + ": " + (err==ENOENT ? "command not found" : strerror(err)) + "\n";
+}
+
+std::string resolveCommand(CommandIndex& commands, const std::string& name) {
+    if (name.find('/') != std::string::npos) return name;
+    const CommandIndex::Entry* e = commands.lookup(name);
+    return e ? e->path : std::string();
+}
+
+pid_t spawnCommand(Spawn& sp, CommandIndex& commands, const std::vector<std::string>& argv) {
+    if (argv.empty()) { errno = EINVAL; return -1; }
+    std::string path = resolveCommand(commands, argv[0]);
+    pid_t pid = sp.run(argv, path);
+    if (pid < 0 && errno == ENOENT && !path.empty() && argv[0].find('/') == std::string::npos) {
+        commands.invalidate();
+        std::string again = resolveCommand(commands, argv[0]);
+        if (again != path) pid = sp.run(argv, again);
+        else errno = ENOENT;
+    }
+    return pid;
+}
+
+LaunchedPipeline launchPipeline(const Pipeline& p, const PipelineIo& io, CommandIndex& commands) {
+    LaunchedPipeline out;
+    const auto& stages = p.stages;
+    int n = (int)stages.size();
+    if (n == 0) { out.failStatus = 1; out.errors = "invalid command\n"; return out; }
+    // Pipes between stages
+    std::vector<int> pipesFD((n-1)*2, -1);
+    for (int i=0;i<n-1;i++) {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC)<0) {
+            for (int fd : pipesFD) if (fd>=0) close(fd);
+            out.failStatus = 1;
+            out.errors = "pipe() failed\n";
+            return out;
+        }
+        pipesFD[i*2]=fds[0]; pipesFD[i*2+1]=fds[1];
+    }
+
+    pid_t firstPid = -1;
+    out.failStatus = 127;
+    for (int i=0;i<n;i++) {
+        const SimpleCommand& cmd = stages[i];
+        std::vector<int> files;
+        std::string failed = cmd.words.empty() ? "invalid command\n" : "";
+        for (const auto& r : cmd.redirects) {
+            if (!failed.empty()) break;
+            if (r.op == Redirect::Dup) continue;
+            int flags = r.op==Redirect::Read ? O_RDONLY : r.op==Redirect::Append ? (O_WRONLY|O_CREAT|O_APPEND) : (O_WRONLY|O_CREAT|O_TRUNC);
+            int fd = open(r.target.c_str(), flags|O_CLOEXEC, 0666);
+            if (fd<0) { failed = r.target + ": " + strerror(errno) + "\n"; break; }
+            files.push_back(fd);
+        }
+        pid_t pid = -1;
+        if (!failed.empty()) {
+            out.errors += failed;
+        } else {
+            auto expanded_argv = expandWords(cmd.words);
+            Spawn sp;
+            if (io.ownGroup) sp.setProcessGroup(firstPid>0 ? firstPid : 0);
+            // Pipe wiring first; the stage's own redirections apply on top, in order (> f 2>&1)
+            if (i>0) sp.dup2(pipesFD[(i-1)*2], STDIN_FILENO);
+            else if (io.in>=0) sp.dup2(io.in, STDIN_FILENO);
+            if (i<n-1) sp.dup2(pipesFD[i*2+1], STDOUT_FILENO);
+            else if (io.out>=0) sp.dup2(io.out, STDOUT_FILENO);
+            if (io.err>=0) sp.dup2(io.err, STDERR_FILENO);
+            size_t f = 0;
+            for (const auto& r : cmd.redirects) {
+                if (r.op == Redirect::Dup) sp.dup2(r.dupFd, r.fd);
+                else sp.dup2(files[f++], r.fd);
+            }
+            pid = spawnCommand(sp, commands, expanded_argv);
+            if (pid<0) out.errors += spawnError(expanded_argv[0], errno);
+        }
+        for (int fd : files) close(fd);
+        // A stage that did not start leaves its neighbours to see EOF / EPIPE on the pipes between them
+        if (pid>0) {
+            out.pids.push_back(pid);
+            if (firstPid<0) firstPid = pid;
+        }
+        if (i==n-1) { out.last = pid; if (!failed.empty()) out.failStatus = 1; }
+    }
+    for (int fd : pipesFD) if (fd>=0) close(fd);
+    if (io.ownGroup) out.pgid = firstPid;
+    return out;
+}
+
+} // namespace myterm
@@ -1,6 +1,9 @@
 #include "core/History.hpp"
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
+#include <pwd.h>
+#include <unistd.h>
 #include <unordered_set>
 
 namespace myterm {
@@ -25,6 +28,14 @@ int History::search(const std::string& term) const {
     return -1;
 }
 
+std::string History::defaultPath() {
+    const char* home = getenv("HOME");
+    if (!home) {
+        if (passwd* pw = getpwuid(getuid())) home = pw->pw_dir;
+    }
+    return home ? std::string(home) + "/.myterm_history" : std::string();
+}
+
 void History::loadFromFile(const std::string& path) {
     std::ifstream in(path);
     if (!in) return;
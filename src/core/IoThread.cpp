@@ -0,0 +1,141 @@
+#include "core/IoThread.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace myterm {
+
+static void signal_eventfd(int fd) {
+    uint64_t one = 1;
+    (void)!write(fd, &one, sizeof one);
+}
+
+static void drain_eventfd(int fd) {
+    uint64_t n;
+    (void)!read(fd, &n, sizeof n);
+}
+
+IoThread::IoThread() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    kickFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = kickFd_;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, kickFd_, &ev);
+    thread_ = std::thread([this] { loop(); });
+}
+
+IoThread::~IoThread() {
+    stop_.store(true);
+    signal_eventfd(kickFd_);
+    if (thread_.joinable()) thread_.join();
+    close(epfd_);
+    close(wakeFd_);
+    close(kickFd_);
+}
+
+void IoThread::clearWake() {
+    drain_eventfd(wakeFd_);
+}
+
+void IoThread::watch(int fd) {
+    if (fd < 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::find(fds_.begin(), fds_.end(), fd) != fds_.end()) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == 0) fds_.push_back(fd);
+}
+
+void IoThread::unwatch(int fd) {
+    if (fd < 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(fds_.begin(), fds_.end(), fd);
+    // Gone already when the reader hit EOF, but its eof chunk may still be queued
+    if (it != fds_.end()) {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+        fds_.erase(it);
+    }
+    // Everything read from fd so far is already queued (pushes happen under the lock)
+    dropped_.emplace_back(fd, seq_);
+}
+
+bool IoThread::pop(Chunk& c) {
+    while (queue_.pop(c)) {
+        if (waiting_.load()) signal_eventfd(kickFd_);
+        bool stale = std::any_of(dropped_.begin(), dropped_.end(),
+                                 [&](const std::pair<int, uint64_t>& d) { return d.first == c.fd && c.seq < d.second; });
+        // Chunks come in seq order: bounds at or below this one can't match anything later
+        dropped_.erase(std::remove_if(dropped_.begin(), dropped_.end(),
+                                      [&](const std::pair<int, uint64_t>& d) { return d.second <= c.seq + 1; }),
+                       dropped_.end());
+        if (!stale) return true;
+    }
+    dropped_.clear(); // drained: whatever predates an unwatch() is gone
+    return false;
+}
+
+bool IoThread::readFd(int fd) {
+    for (int i = 0; i < kReadsPerWake; ++i) {
+        if (queue_.full()) return false;
+        scratch_.data.resize(kChunkBytes);
+        ssize_t n = read(fd, &scratch_.data[0], kChunkBytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        scratch_.fd = fd;
+        scratch_.seq = seq_++;
+        if (n > 0) {
+            scratch_.data.resize((size_t)n);
+            scratch_.eof = false;
+            queue_.push(scratch_);
+            continue;
+        }
+        // EOF, or an error such as EIO on a PTY master whose slave side is gone
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+        fds_.erase(std::find(fds_.begin(), fds_.end(), fd));
+        scratch_.data.clear();
+        scratch_.eof = true;
+        queue_.push(scratch_);
+        break;
+    }
+    return true;
+}
+
+void IoThread::loop() {
+    epoll_event events[64];
+    while (!stop_.load()) {
+        int n = epoll_wait(epfd_, events, 64, -1);
+        if (n < 0) continue; // EINTR
+        bool full = false, pushed = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const uint64_t before = seq_;
+            for (int i = 0; i < n && !full; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == kickFd_) { drain_eventfd(kickFd_); continue; }
+                // May have been unwatched between epoll_wait() and taking the lock
+                if (std::find(fds_.begin(), fds_.end(), fd) == fds_.end()) continue;
+                full = !readFd(fd);
+            }
+            pushed = seq_ != before;
+        }
+        if (pushed) signal_eventfd(wakeFd_);
+        if (full) {
+            // Wait for the UI to make room; readable descriptors would only spin epoll_wait()
+            waiting_.store(true);
+            while (queue_.full() && !stop_.load()) {
+                pollfd p{kickFd_, POLLIN, 0};
+                poll(&p, 1, -1);
+                drain_eventfd(kickFd_);
+            }
+            waiting_.store(false);
+        }
+    }
+}
+
+} // namespace myterm
@@ -0,0 +1,45 @@
+#include "core/LatencyHistogram.hpp"
+#include <algorithm>
+
+namespace myterm {
+
+size_t LatencyHistogram::bucketOf(uint64_t v) {
+    if (v < kLinear) return (size_t)v;
+    const unsigned msb = 63u - (unsigned)__builtin_clzll(v);  // >= kSubBits
+    const unsigned shift = msb - (kSubBits - 1);               // keeps the top kSubBits bits
+    return (size_t)(kLinear + (msb - kSubBits) * kHalf + ((v >> shift) - kHalf));
+}
+
+uint64_t LatencyHistogram::highestIn(size_t bucket) {
+    if (bucket < kLinear) return bucket;
+    const uint64_t k = bucket - kLinear;
+    const unsigned shift = (unsigned)(k / kHalf) + 1;
+    const uint64_t top = kHalf + k % kHalf;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t us) {
+    const size_t b = bucketOf(us);
+    if (b >= buckets_.size()) buckets_.resize(b + 1, 0);
+    ++buckets_[b];
+    min_ = count_ ? std::min(min_, us) : us;
+    max_ = std::max(max_, us);
+    ++count_;
+}
+
+uint64_t LatencyHistogram::quantile(double q) const {
+    if (count_ == 0) return 0;
+    q = std::min(1.0, std::max(0.0, q));
+    // Rank of the value asked for, 1-based: the ceiling of q * count, at least 1
+    uint64_t rank = (uint64_t)(q * (double)count_);
+    if ((double)rank < q * (double)count_) ++rank;
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets_.size(); ++b) {
+        seen += buckets_[b];
+        if (seen >= rank) return std::min(highestIn(b), max_);
+    }
+    return max_;
+}
+
+} // namespace myterm
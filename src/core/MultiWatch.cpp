@@ -0,0 +1,772 @@
+#include "core/MultiWatch.hpp"
+#include "core/Exec.hpp"
+#include "core/LatencyHistogram.hpp"
+#include "core/WatchLog.hpp"
+#include "core/Spawn.hpp"
+#include "core/WatchPanes.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Process groups of the pool's shells, killed (with whatever they run) when the worker is
+// interrupted: one slot per shell, -1 while it is down. Allocated before the handlers are
+// installed and never resized, so the handler can walk it at any point.
+static volatile sig_atomic_t* mw_pids = nullptr;
+static size_t mw_pid_slots = 0;
+// With --stats or --log the worker leaves from its loop, once the report and the log are out
+static volatile sig_atomic_t mw_stop_later = 0;
+static volatile sig_atomic_t mw_stop = 0;
+static void mw_signal_handler(int) {
+    for (size_t k = 0; k < mw_pid_slots; ++k) {
+        pid_t p = (pid_t)mw_pids[k];
+        if (p > 0) kill(-p, SIGKILL);
+    }
+    if (!mw_stop_later) _exit(0);
+    mw_stop = 1;
+}
+
+static const char kRule[] = "----------------------------------------------------\n";
+
+static void mw_write(const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(STDOUT_FILENO, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return;
+        p += w; n -= (size_t)w;
+    }
+}
+
+static void mw_write(const std::string& s) { mw_write(s.data(), s.size()); }
+
+static long long mw_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static struct timespec mw_timespec(long long ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000LL);
+    ts.tv_nsec = (long)(ns % 1000000000LL);
+    return ts;
+}
+
+namespace myterm {
+
+namespace {
+
+// One command of the running round
+struct WatchJob {
+    size_t cmd = 0;
+    int shell = -1;         // pool shell running it; -1 while queued and once done
+    uint64_t round = 0;     // 1 for the first
+    bool done = false;
+    long long startNs = 0;
+    long long jitterNs = 0; // start time minus the round's deadline
+    unsigned skipped = 0;   // ticks dropped before this round
+    bool header = false;
+    std::vector<uint64_t> hashes; // of the lines so far
+    std::string line;       // line in progress (at most WatchPanes::kMaxPaneBytes of it)
+    size_t lineLen = 0;     // its length, including what was cut off
+    uint64_t lineHash = 0;
+    std::string out;        // changed lines not written yet
+    uint32_t keep = 0;      // unchanged lines not written yet (records)
+};
+
+// A command's lines in the round before, as hashes
+struct LineHistory {
+    std::vector<uint64_t> hashes;
+    bool seen = false;      // a round has finished
+};
+
+// A long-lived `sh` of the pool. Commands go to its stdin one line each; after a
+// command it prints the sentinel, which marks the end of that command's output.
+struct PoolShell {
+    pid_t pid = -1;         // also its process group; -1 until (re)started
+    int in = -1;            // its stdin
+    int out = -1;           // its stdout and stderr
+    int job = -1;           // index into the round's jobs; -1 when idle
+    size_t slot = 0;        // its entry in mw_pids
+    std::string held;       // output held back: it may be the start of the sentinel
+};
+
+// How each command's runs went, for the summary row and the --stats report
+struct CommandStats {
+    LatencyHistogram runtime;       // microseconds, of the runs that ended by themselves
+    uint64_t lastUs = 0;
+    std::map<int, uint64_t> exits;  // exit status (128 + n: signal n) -> runs
+    uint64_t timeouts = 0;
+    uint64_t killed = 0;            // by the kill overlap policy
+    uint64_t failed = 0;            // could not be started
+};
+
+// How a run ended when it has no exit status of its own; below -1, which mw_shell_stop()
+// returns for a status it could not get
+constexpr int kRunTimedOut = -2, kRunKilled = -3, kRunFailed = -4;
+
+struct WatchRound {
+    std::vector<WatchJob> jobs;
+    size_t next = 0;        // first job not handed to a shell yet
+    size_t left = 0;        // jobs not done
+    long long deadlineNs = 0;
+};
+
+} // namespace
+
+// Output goes out as text (header, output, trailer), or as WatchRecords for the window
+static bool mw_records = false;
+// Whether output is taken apart into lines and compared with the last round
+static bool mw_diff = false;
+static std::vector<LineHistory> mw_history;
+static std::vector<CommandStats> mw_stats;
+static unsigned long long mw_rounds = 0;
+static WatchLog mw_log;
+
+// FNV-1a over the bytes of a line
+static constexpr uint64_t kLineHashBasis = 1469598103934665603ull;
+static uint64_t mw_hash(uint64_t h, const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) { h ^= (unsigned char)p[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+static void mw_record(WatchRecord kind, size_t cmd, const char* p, size_t n) {
+    char head[kWatchRecordHeader] = {};
+    uint32_t idx = (uint32_t)cmd, len = (uint32_t)n;
+    head[0] = (char)kind;
+    memcpy(head + 4, &idx, 4);
+    memcpy(head + 8, &len, 4);
+    std::string rec(head, sizeof head);
+    rec.append(p, n);
+    mw_write(rec);
+}
+
+static void mw_header(const MultiWatchSpec& spec, WatchJob& j) {
+    if (j.header) return;
+    j.header = true;
+    char extra[64];
+    snprintf(extra, sizeof extra, " , jitter: %+.2fms", (double)j.jitterNs / 1e6);
+    std::string header = "\"" + spec.cmds[j.cmd] + "\" , current_time: " + std::to_string(time(nullptr)) + extra;
+    if (j.skipped) header += " , skipped: " + std::to_string(j.skipped);
+    header += " :";
+    if (mw_records) { mw_record(WatchRecord::Begin, j.cmd, header.data(), header.size()); return; }
+    header += "\n";
+    header += kRule;
+    mw_write(header);
+}
+
+// Write out what a job has pending: a run of unchanged lines or some changed ones
+static void mw_flush(const MultiWatchSpec& spec, WatchJob& j) {
+    if (j.keep == 0 && j.out.empty()) return;
+    mw_header(spec, j);
+    if (j.keep) {
+        mw_record(WatchRecord::Keep, j.cmd, reinterpret_cast<const char*>(&j.keep), sizeof j.keep);
+        j.keep = 0;
+    }
+    if (j.out.empty()) return;
+    if (mw_records) mw_record(WatchRecord::Data, j.cmd, j.out.data(), j.out.size());
+    else mw_write(j.out);
+    j.out.clear();
+}
+
+// One whole line of output (with its newline, unless it is the last one)
+static void mw_line(const MultiWatchSpec& spec, WatchJob& j) {
+    const LineHistory& prev = mw_history[j.cmd];
+    const size_t index = j.hashes.size();
+    const bool same = prev.seen && index < prev.hashes.size() && prev.hashes[index] == j.lineHash;
+    j.hashes.push_back(j.lineHash);
+    const bool newline = !j.line.empty() && j.line.back() == '\n';
+    if (mw_records) {
+        if (same) {
+            if (!j.out.empty()) mw_flush(spec, j);
+            ++j.keep;
+        } else {
+            if (j.keep) mw_flush(spec, j);
+            j.out += j.line;
+        }
+    } else if (spec.changesOnly && same) {
+        // left out
+    } else {
+        if (spec.changesOnly) j.out += std::to_string(index + 1) + ": ";
+        if (spec.highlight && prev.seen && !same) {
+            j.out += "\x1b[7m";
+            j.out.append(j.line, 0, j.line.size() - (newline ? 1 : 0));
+            j.out += "\x1b[0m";
+            if (newline) j.out += '\n';
+        } else {
+            j.out += j.line;
+        }
+        if (spec.changesOnly && !newline) j.out += '\n';
+    }
+    j.line.clear();
+    j.lineLen = 0;
+    j.lineHash = kLineHashBasis;
+}
+
+static void mw_output(const MultiWatchSpec& spec, WatchJob& j, const char* p, size_t n) {
+    mw_log.output(j.cmd, j.round, p, n);
+    if (!mw_diff) { mw_header(spec, j); mw_write(p, n); return; }
+    size_t i = 0;
+    while (i < n) {
+        const char* nl = (const char*)memchr(p + i, '\n', n - i);
+        const size_t e = nl ? (size_t)(nl - p) + 1 : n;
+        if (j.lineLen == 0) j.lineHash = kLineHashBasis;
+        j.lineHash = mw_hash(j.lineHash, p + i, e - i);
+        j.lineLen += e - i;
+        if (j.line.size() < WatchPanes::kMaxPaneBytes)
+            j.line.append(p + i, std::min(e - i, WatchPanes::kMaxPaneBytes - j.line.size()));
+        if (nl) {
+            if (j.line.back() != '\n') j.line.push_back('\n'); // cut short: keep the line a line
+            mw_line(spec, j);
+        }
+        i = e;
+    }
+    mw_flush(spec, j);
+}
+
+// End a job's round: the rest of its output, then its trailer with `note` and the
+// summary row `stats`. The lines of the round become the ones the next round is
+// compared with.
+static void mw_trailer(const MultiWatchSpec& spec, WatchJob& j, std::string note, const std::string& stats = std::string()) {
+    if (mw_diff) {
+        if (j.lineLen > 0) mw_line(spec, j);
+        mw_flush(spec, j);
+        LineHistory& prev = mw_history[j.cmd];
+        if (!mw_records && spec.changesOnly && prev.seen) {
+            const size_t gone = prev.hashes.size() > j.hashes.size() ? prev.hashes.size() - j.hashes.size() : 0;
+            if (gone) note = "[" + std::to_string(gone) + (gone == 1 ? " fewer line]\n" : " fewer lines]\n") + note;
+            // Nothing changed: the round does not show at all
+            if (!j.header && note.empty()) { prev.hashes.swap(j.hashes); return; }
+        }
+        prev.hashes.swap(j.hashes);
+        prev.seen = true;
+    }
+    mw_header(spec, j);
+    if (mw_records) {
+        if (!stats.empty()) mw_record(WatchRecord::Stats, j.cmd, stats.data(), stats.size());
+        mw_record(WatchRecord::End, j.cmd, note.data(), note.size());
+        return;
+    }
+    if (spec.stats && !stats.empty()) note += "[" + stats + "]\n";
+    mw_write(note + kRule);
+}
+
+// 850us, 12.3ms, 1.25s
+static std::string mw_duration(uint64_t us) {
+    char b[32];
+    if (us < 1000) snprintf(b, sizeof b, "%lluus", (unsigned long long)us);
+    else if (us < 1000000) snprintf(b, sizeof b, "%.1fms", (double)us / 1e3);
+    else snprintf(b, sizeof b, "%.2fs", (double)us / 1e6);
+    return b;
+}
+
+// exit 0:41 1:2, timeouts 1, ...
+static std::string mw_outcomes(const CommandStats& st) {
+    std::string s;
+    if (!st.exits.empty()) {
+        s = "exit";
+        for (auto& e : st.exits) s += " " + std::to_string(e.first) + ":" + std::to_string(e.second);
+    }
+    auto add = [&](const char* what, uint64_t n) {
+        if (!n) return;
+        if (!s.empty()) s += ", ";
+        s += what + std::string(" ") + std::to_string(n);
+    };
+    add("timeouts", st.timeouts);
+    add("killed", st.killed);
+    add("failed", st.failed);
+    return s;
+}
+
+static std::string mw_summary(const CommandStats& st) {
+    std::string s;
+    if (st.runtime.count()) {
+        s = "last " + mw_duration(st.lastUs) + "  p50 " + mw_duration(st.runtime.quantile(0.5)) +
+            "  p99 " + mw_duration(st.runtime.quantile(0.99)) + "  max " + mw_duration(st.runtime.max());
+    }
+    std::string outcomes = mw_outcomes(st);
+    if (!s.empty() && !outcomes.empty()) s += "  ";
+    return s + outcomes;
+}
+
+// The --stats report: one row per command over the whole run
+static void mw_report(const MultiWatchSpec& spec, long long startNs) {
+    char b[512];
+    snprintf(b, sizeof b, "multiWatch: %llu rounds in %s\n%-32s %6s %9s %9s %9s %9s %9s  %s\n", mw_rounds,
+             mw_duration((uint64_t)(mw_now_ns() - startNs) / 1000).c_str(), "command", "runs", "min", "p50", "p90",
+             "p99", "max", "outcomes");
+    std::string report = b;
+    for (size_t i = 0; i < spec.cmds.size(); ++i) {
+        const CommandStats& st = mw_stats[i];
+        const LatencyHistogram& h = st.runtime;
+        std::string cmd = spec.cmds[i].size() > 32 ? spec.cmds[i].substr(0, 31) + "~" : spec.cmds[i];
+        auto d = [&](uint64_t us) { return h.count() ? mw_duration(us) : std::string("-"); };
+        snprintf(b, sizeof b, "%-32s %6llu %9s %9s %9s %9s %9s  %s\n", cmd.c_str(), (unsigned long long)h.count(),
+                 d(h.min()).c_str(), d(h.quantile(0.5)).c_str(), d(h.quantile(0.9)).c_str(), d(h.quantile(0.99)).c_str(),
+                 d(h.max()).c_str(), mw_outcomes(st).c_str());
+        report += b;
+    }
+    if (mw_records) mw_record(WatchRecord::Report, 0, report.data(), report.size());
+    else mw_write(report);
+}
+
+// 2, 0.5, 2s, 250ms; false when `s` is no interval
+static bool parse_interval(const std::string& s, long long& ms) {
+    if (s.empty() || !(isdigit((unsigned char)s[0]) || s[0]=='.')) return false;
+    char* end = nullptr;
+    double v = strtod(s.c_str(), &end);
+    std::string unit(end);
+    if (unit.empty() || unit == "s") v *= 1000.0;
+    else if (unit != "ms") return false;
+    ms = (long long)(v + 0.5);
+    return true;
+}
+
+bool parseMultiWatch(const std::vector<std::string>& args, MultiWatchSpec& spec, std::string& error) {
+    spec = MultiWatchSpec{};
+    std::vector<std::string>& cmds = spec.cmds;
+    size_t argStart = 1;
+    for (; args.size() > argStart; ++argStart) {
+        const std::string& opt = args[argStart];
+        if (opt == "-d" || opt == "--differences") { spec.highlight = true; continue; }
+        if (opt == "--changes-only") { spec.changesOnly = true; continue; }
+        if (opt == "--stats") { spec.stats = true; continue; }
+        if (opt == "--log" || opt.compare(0, 6, "--log=") == 0) {
+            if (opt == "--log" && args.size() > argStart + 1) spec.logPath = args[++argStart];
+            else if (opt != "--log") spec.logPath = opt.substr(6);
+            if (spec.logPath.empty()) { error = "multiWatch: --log wants a file name"; return false; }
+            continue;
+        }
+        if (opt.compare(0, 13, "--log-format=") == 0) {
+            std::string format = opt.substr(13);
+            if (format == "jsonl" || format == "json") spec.logBinary = false;
+            else if (format == "binary") spec.logBinary = true;
+            else { error = "multiWatch: unknown log format '" + format + "' (jsonl or binary)"; return false; }
+            continue;
+        }
+        if (opt.compare(0, 7, "--jobs=") == 0) {
+            char* end = nullptr;
+            long n = strtol(opt.c_str() + 7, &end, 10);
+            if (opt.size() == 7 || *end || n < 1) { error = "multiWatch: --jobs wants a positive number"; return false; }
+            spec.jobs = (size_t)n;
+            continue;
+        }
+        if (opt.compare(0, 10, "--timeout=") == 0) {
+            if (!parse_interval(opt.substr(10), spec.timeoutMs) || spec.timeoutMs < 1) {
+                error = "multiWatch: --timeout wants a time such as 5, 0.5 or 500ms";
+                return false;
+            }
+            continue;
+        }
+        if (opt.compare(0, 10, "--overlap=") != 0) break;
+        std::string policy = opt.substr(10);
+        if (policy == "skip") spec.overlap = Overlap::Skip;
+        else if (policy == "queue") spec.overlap = Overlap::Queue;
+        else if (policy == "kill") spec.overlap = Overlap::Kill;
+        else { error = "multiWatch: unknown overlap policy '" + policy + "' (skip, queue or kill)"; return false; }
+    }
+    if (args.size() > argStart && parse_interval(args[argStart], spec.intervalMs)) {
+        if (spec.intervalMs < 1) { error = "multiWatch: interval must be at least 1ms"; return false; }
+        ++argStart;
+    }
+    // Try to parse list form: everything after args[0] joined, parse [ ... ] items respecting quotes
+    if (args.size() > argStart) {
+        std::string joined;
+        for (size_t i = argStart; i < args.size(); ++i) {
+            if (i > argStart) joined.push_back(' ');
+            joined += args[i];
+        }
+        size_t lb = joined.find('[');
+        size_t rb = joined.rfind(']');
+        if (lb != std::string::npos && rb != std::string::npos && rb > lb) {
+            std::string body = joined.substr(lb + 1, rb - lb - 1);
+            std::string cur; bool inS=false, inD=false;
+            for (size_t i=0;i<body.size();++i) {
+                char c = body[i];
+                if (c=='"' && !inS){ inD=!inD; continue; }
+                if (c=='\'' && !inD){ inS=!inS; continue; }
+                if (!inS && !inD && c==',') { if (!cur.empty()) { cmds.push_back(cur); cur.clear(); } continue; }
+                cur.push_back(c);
+            }
+            if (!cur.empty()) cmds.push_back(cur);
+            // Trim surrounding spaces and quotes
+            for (auto &s : cmds) {
+                while (!s.empty() && isspace((unsigned char)s.front())) s.erase(s.begin());
+                while (!s.empty() && isspace((unsigned char)s.back())) s.pop_back();
+                if (s.size()>=2 && ((s.front()=='"' && s.back()=='"') || (s.front()=='\'' && s.back()=='\''))) {
+                    s = s.substr(1, s.size()-2);
+                }
+            }
+        }
+        if (cmds.empty()) {
+            // Fallback: treat remaining args as commands directly
+            for (size_t i=argStart;i<args.size();++i) cmds.push_back(args[i]);
+        }
+    }
+    if (cmds.empty()) { error = "multiWatch: no commands specified"; return false; }
+    return true;
+}
+
+static std::string mw_sentinel; // unique to this worker
+static std::string mw_cwd;      // every command starts here
+
+static std::string mw_quote(const std::string& s) {
+    std::string q = "'";
+    for (char c : s) {
+        if (c == '\'') q += "'\\''";
+        else q.push_back(c);
+    }
+    return q + "'";
+}
+
+static bool mw_shell_start(PoolShell& s) {
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) < 0) return false;
+    if (pipe2(out, O_CLOEXEC) < 0) { int err = errno; close(in[0]); close(in[1]); errno = err; return false; }
+    // A group of its own, so killing the shell takes whatever its command started along
+    Spawn sp;
+    sp.setProcessGroup(0);
+    sp.dup2(in[0], STDIN_FILENO);
+    sp.dup2(out[1], STDOUT_FILENO);
+    sp.dup2(out[1], STDERR_FILENO);
+    pid_t p = sp.run({"sh"});
+    int err = errno;
+    close(in[0]);
+    close(out[1]);
+    if (p < 0) { close(in[1]); close(out[0]); errno = err; return false; }
+    s.pid = p;
+    s.in = in[1];
+    s.out = out[0];
+    s.held.clear();
+    mw_pids[s.slot] = p;
+    return true;
+}
+
+// Kill a shell with its command; the next job it gets starts a fresh one. Returns how
+// the shell ended as an exit status (128 + n for signal n), -1 if unknown.
+static int mw_shell_stop(PoolShell& s) {
+    if (s.pid < 0) return -1;
+    kill(-s.pid, SIGKILL);
+    mw_pids[s.slot] = -1;
+    close(s.in);
+    close(s.out);
+    int ws = 0, status = -1;
+    pid_t w;
+    while ((w = waitpid(s.pid, &ws, 0)) < 0 && errno == EINTR) {}
+    if (w == s.pid) status = WIFEXITED(ws) ? WEXITSTATUS(ws) : WIFSIGNALED(ws) ? 128 + WTERMSIG(ws) : -1;
+    s.pid = s.in = s.out = -1;
+    s.job = -1;
+    s.held.clear();
+    return status;
+}
+
+// Hand `cmd` to the shell. It runs in the worker's directory with stdin from /dev/null;
+// `command eval` keeps a syntax error in it from ending the shell. The sentinel is
+// followed by the command's exit status and a ';'.
+static bool mw_shell_run(PoolShell& s, const std::string& cmd) {
+    std::string line;
+    if (!mw_cwd.empty()) line = "cd -- " + mw_quote(mw_cwd) + " 2>/dev/null; ";
+    line += "command eval " + mw_quote(cmd) + " </dev/null 2>&1; printf '%s%d;' " + mw_quote(mw_sentinel) + " \"$?\"\n";
+    const char* p = line.data();
+    size_t n = line.size();
+    while (n > 0) {
+        ssize_t w = write(s.in, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w; n -= (size_t)w;
+    }
+    return true;
+}
+
+// Close a job's stream with its trailer (and a note on why, if it did not end by itself).
+// `status` is the command's exit status or one of kRunTimedOut, kRunKilled, kRunFailed.
+static void mw_finish(const MultiWatchSpec& spec, WatchRound& r, WatchJob& j, const char* note, int status) {
+    CommandStats& st = mw_stats[j.cmd];
+    const long long runtimeNs = mw_now_ns() - j.startNs;
+    mw_log.end(j.cmd, j.round,
+               status >= 0 ? WatchLog::Outcome::Exit : status == kRunTimedOut ? WatchLog::Outcome::Timeout
+               : status == kRunKilled ? WatchLog::Outcome::Killed : WatchLog::Outcome::Failed,
+               status, runtimeNs);
+    if (status >= 0) {
+        st.lastUs = (uint64_t)std::max(0LL, runtimeNs) / 1000;
+        st.runtime.record(st.lastUs);
+        ++st.exits[status];
+    } else if (status == kRunTimedOut) {
+        ++st.timeouts;
+    } else if (status == kRunKilled) {
+        ++st.killed;
+    } else {
+        ++st.failed;
+    }
+    mw_trailer(spec, j, note ? note : "", mw_summary(st));
+    j.done = true;
+    j.shell = -1;
+    --r.left;
+}
+
+// Give queued jobs to idle shells, starting shells as needed
+static void mw_dispatch(const MultiWatchSpec& spec, WatchRound& r, std::vector<PoolShell>& shells) {
+    for (size_t k = 0; k < shells.size() && r.next < r.jobs.size(); ++k) {
+        PoolShell& s = shells[k];
+        while (s.job < 0 && r.next < r.jobs.size()) {
+            WatchJob& j = r.jobs[r.next];
+            j.startNs = mw_now_ns();
+            j.jitterNs = j.startNs - r.deadlineNs;
+            mw_log.start(j.cmd, j.round, j.jitterNs);
+            // A shell that went away since its last command shows as a failed write: start over once
+            bool ok = false;
+            int err = 0;
+            for (int attempt = 0; attempt < 2 && !ok; ++attempt) {
+                if (s.pid < 0 && !mw_shell_start(s)) { err = errno; break; }
+                ok = mw_shell_run(s, spec.cmds[j.cmd]);
+                if (!ok) { err = errno; mw_shell_stop(s); }
+            }
+            if (!ok) {
+                mw_finish(spec, r, j, spawnError("sh", err).c_str(), kRunFailed);
+            } else {
+                j.shell = (int)k;
+                s.job = (int)r.next;
+            }
+            ++r.next;
+        }
+    }
+}
+
+// Start a round due at deadlineNs
+static void mw_start_round(const MultiWatchSpec& spec, WatchRound& r, long long deadlineNs, unsigned skipped,
+                           std::vector<PoolShell>& shells) {
+    ++mw_rounds;
+    r.jobs.assign(spec.cmds.size(), WatchJob{});
+    for (size_t i = 0; i < r.jobs.size(); ++i) {
+        r.jobs[i].cmd = i;
+        r.jobs[i].round = mw_rounds;
+        r.jobs[i].skipped = skipped;
+    }
+    r.next = 0;
+    r.left = r.jobs.size();
+    r.deadlineNs = deadlineNs;
+    mw_dispatch(spec, r, shells);
+}
+
+// Output of a shell: its command's, up to the sentinel
+static void mw_shell_read(const MultiWatchSpec& spec, WatchRound& r, PoolShell& s) {
+    char buf[4096];
+    ssize_t n = read(s.out, buf, sizeof buf);
+    if (n < 0 && errno == EINTR) return;
+    if (n <= 0) {
+        // The shell is gone (the command ran `exit`, say); what it printed still counts
+        const int job = s.job;
+        std::string held;
+        held.swap(s.held);
+        int status = mw_shell_stop(s);
+        if (status < 0) status = kRunFailed; // died, but how is unknown
+        if (job >= 0) {
+            WatchJob& j = r.jobs[(size_t)job];
+            if (!held.empty()) mw_output(spec, j, held.data(), held.size());
+            mw_finish(spec, r, j, nullptr, status);
+        }
+        return;
+    }
+    if (s.job < 0) return; // left behind by a finished command's background processes
+    WatchJob& j = r.jobs[(size_t)s.job];
+    s.held.append(buf, (size_t)n);
+    size_t end = s.held.find(mw_sentinel);
+    if (end != std::string::npos) {
+        if (end > 0) {
+            mw_output(spec, j, s.held.data(), end);
+            s.held.erase(0, end);
+        }
+        const size_t semi = s.held.find(';', mw_sentinel.size());
+        if (semi == std::string::npos) return; // the status is still to come
+        const int status = atoi(s.held.c_str() + mw_sentinel.size());
+        s.held.clear();
+        s.job = -1;
+        mw_finish(spec, r, j, nullptr, status);
+        return;
+    }
+    const size_t keep = std::min(s.held.size(), mw_sentinel.size() - 1);
+    if (s.held.size() > keep) {
+        mw_output(spec, j, s.held.data(), s.held.size() - keep);
+        s.held.erase(0, s.held.size() - keep);
+    }
+}
+
+// Kill the shell running job `j` and end the job with `note`
+static void mw_abort(const MultiWatchSpec& spec, WatchRound& r, std::vector<PoolShell>& shells, WatchJob& j,
+                     const std::string& note, int status) {
+    PoolShell& s = shells[(size_t)j.shell];
+    std::string held;
+    held.swap(s.held);
+    mw_shell_stop(s);
+    if (!held.empty()) mw_output(spec, j, held.data(), held.size());
+    mw_finish(spec, r, j, note.c_str(), status);
+}
+
+static std::string mw_sentinel_make() {
+    unsigned char raw[12] = {};
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    bool random = fd >= 0 && read(fd, raw, sizeof raw) == (ssize_t)sizeof raw;
+    if (fd >= 0) close(fd);
+    if (!random) {
+        long long seed = mw_now_ns() ^ ((long long)getpid() << 32);
+        memcpy(raw, &seed, sizeof seed);
+    }
+    static const char hex[] = "0123456789abcdef";
+    std::string s = "<<multiWatch:";
+    for (unsigned char c : raw) { s.push_back(hex[c >> 4]); s.push_back(hex[c & 15]); }
+    return s + ">>";
+}
+
+// The worker cannot run at all: say why, in place of every command's output
+[[noreturn]] static void mw_fail(const MultiWatchSpec& spec, const std::string& msg) {
+    if (!mw_records) mw_write(msg);
+    for (size_t i=0; mw_records && i<spec.cmds.size(); ++i) {
+        WatchJob j;
+        j.cmd = i;
+        mw_trailer(spec, j, msg);
+    }
+    mw_log.close();
+    _exit(1);
+}
+
+void runMultiWatch(const MultiWatchSpec& spec) {
+    // The pool: up to spec.jobs commands run at once, each in a shell that stays
+    const size_t poolSize = spec.jobs > 0 ? std::min(spec.jobs, spec.cmds.size()) : spec.cmds.size();
+    mw_pids = new volatile sig_atomic_t[std::max<size_t>(poolSize, 1)];
+    for (size_t k = 0; k < poolSize; ++k) mw_pids[k] = -1;
+    mw_pid_slots = poolSize;
+    mw_stop_later = spec.stats || !spec.logPath.empty();
+    signal(SIGINT, mw_signal_handler);
+    signal(SIGTERM, mw_signal_handler);
+    signal(SIGHUP, mw_signal_handler);
+    signal(SIGQUIT, mw_signal_handler);
+    signal(SIGPIPE, SIG_IGN); // a shell that died shows as a failed write
+    mw_records = spec.records;
+    mw_diff = spec.records || spec.highlight || spec.changesOnly;
+    mw_history.assign(spec.cmds.size(), LineHistory{});
+    mw_stats.assign(spec.cmds.size(), CommandStats{});
+    mw_sentinel = mw_sentinel_make();
+    if (char* cwd = getcwd(nullptr, 0)) { mw_cwd = cwd; free(cwd); }
+    const long long periodNs = spec.intervalMs * 1000000LL;
+    const long long timeoutNs = spec.timeoutMs * 1000000LL;
+    // Periodic on absolute deadlines: the kernel schedules tick k at start + k * period
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    const long long start = mw_now_ns();
+    struct itimerspec its{};
+    its.it_value = mw_timespec(start + periodNs);
+    its.it_interval = mw_timespec(periodNs);
+    if (tfd < 0 || timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, nullptr) < 0)
+        mw_fail(spec, std::string("multiWatch: timerfd: ") + strerror(errno) + "\n");
+    if (!spec.logPath.empty()) {
+        std::string error;
+        if (!mw_log.open(spec.logPath, spec.logBinary ? WatchLog::Format::Binary : WatchLog::Format::JsonLines, error))
+            mw_fail(spec, error + "\n");
+        mw_log.watch(spec.cmds, spec.intervalMs);
+    }
+
+    std::vector<PoolShell> shells(poolSize);
+    for (size_t k = 0; k < poolSize; ++k) shells[k].slot = k;
+    WatchRound round;
+    std::vector<struct pollfd> pfds;
+    std::vector<size_t> shellOf;     // pfds[k] (k >= 1) is shells[shellOf[k]]
+    unsigned long long tick = 0;     // deadline of the last tick: start + tick * period
+    bool queued = false;             // Queue: a round is due as soon as this one ends
+    long long queuedDeadline = 0;
+    unsigned skipped = 0;            // ticks dropped since the last round started
+    mw_start_round(spec, round, start, 0, shells);
+    while (true) {
+        if (mw_stop) {
+            if (spec.stats) mw_report(spec, start);
+            // The handler has killed what was still running; the log says so
+            for (auto& j : round.jobs) {
+                if (j.shell >= 0) mw_log.end(j.cmd, j.round, WatchLog::Outcome::Killed, kRunKilled, mw_now_ns() - j.startNs);
+            }
+            mw_log.close();
+            _exit(0);
+        }
+        if (round.left == 0 && queued) {
+            mw_start_round(spec, round, queuedDeadline, skipped, shells);
+            queued = false; skipped = 0;
+            continue;
+        }
+        pfds.clear(); shellOf.clear();
+        struct pollfd tp{}; tp.fd = tfd; tp.events = POLLIN;
+        pfds.push_back(tp); shellOf.push_back(0);
+        int waitMs = -1;
+        const long long now = mw_now_ns();
+        for (size_t k=0;k<shells.size(); ++k) {
+            if (shells[k].pid < 0) continue;
+            struct pollfd pd{}; pd.fd = shells[k].out; pd.events = POLLIN;
+            pfds.push_back(pd); shellOf.push_back(k);
+            if (timeoutNs > 0 && shells[k].job >= 0) {
+                long long left = round.jobs[(size_t)shells[k].job].startNs + timeoutNs - now;
+                int ms = left <= 0 ? 0 : (int)std::min<long long>((left + 999999) / 1000000, 1 << 30);
+                if (waitMs < 0 || ms < waitMs) waitMs = ms;
+            }
+        }
+        int rc = poll(pfds.data(), (nfds_t)pfds.size(), waitMs);
+        if (rc < 0) {
+            if (errno == EINTR) continue; // interrupted by signal
+            break;
+        }
+        // Output first, so a round that ends right at its tick is not counted as overrunning
+        for (size_t k=1;k<pfds.size(); ++k) {
+            if (pfds[k].revents == 0) continue;
+            PoolShell& s = shells[shellOf[k]];
+            if (s.pid >= 0 && s.out == pfds[k].fd) mw_shell_read(spec, round, s);
+        }
+        if (timeoutNs > 0) {
+            const long long late = mw_now_ns() - timeoutNs;
+            for (auto& j : round.jobs) {
+                if (j.shell < 0 || j.startNs > late) continue;
+                mw_abort(spec, round, shells, j, "[timed out after " + std::to_string(spec.timeoutMs) + "ms]\n", kRunTimedOut);
+            }
+        }
+        mw_dispatch(spec, round, shells);
+        const bool running = round.left > 0;
+        if (!(pfds[0].revents & POLLIN)) continue;
+        unsigned long long expirations = 0;
+        if (read(tfd, &expirations, sizeof expirations) != (ssize_t)sizeof expirations) continue;
+        tick += expirations;
+        const long long due = start + (long long)tick * periodNs;
+        // Ticks that were missed altogether (the worker itself was held up) count as skipped
+        skipped += (unsigned)(expirations - 1);
+        if (!running) {
+            mw_start_round(spec, round, due, skipped, shells);
+            skipped = 0;
+            continue;
+        }
+        switch (spec.overlap) {
+            case Overlap::Skip:
+                ++skipped;
+                break;
+            case Overlap::Queue:
+                // The first tick that found the round still running is the one it will serve
+                if (queued) ++skipped;
+                else { queued = true; queuedDeadline = due; }
+                break;
+            case Overlap::Kill:
+                // Commands still waiting for a shell are dropped without a word
+                for (auto& j : round.jobs) {
+                    if (j.shell >= 0) mw_abort(spec, round, shells, j, "[killed: still running at the next tick]\n", kRunKilled);
+                }
+                mw_start_round(spec, round, due, skipped, shells);
+                skipped = 0;
+                break;
+        }
+    }
+    _exit(1);
+}
+
+} // namespace myterm
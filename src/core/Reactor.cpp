@@ -0,0 +1,73 @@
+#include "core/Reactor.hpp"
+#include <cerrno>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace myterm {
+
+Reactor::Reactor() {
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+}
+
+Reactor::~Reactor() {
+    if (epfd_ >= 0) close(epfd_);
+}
+
+void Reactor::watch(int fd) {
+    if (epfd_ < 0 || fd < 0) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    // EEXIST: already watched
+    (void)epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void Reactor::unwatch(int fd) {
+    if (epfd_ < 0 || fd < 0) return;
+    (void)epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+int Reactor::wait(int timeoutMs) {
+    if (epfd_ < 0) return 0;
+    int n;
+    do n = epoll_wait(epfd_, events_, kMaxEvents, timeoutMs);
+    while (n < 0 && errno == EINTR);
+    return n < 0 ? 0 : n;
+}
+
+TimerFd::TimerFd() {
+    fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+TimerFd::~TimerFd() {
+    if (fd_ >= 0) close(fd_);
+}
+
+void TimerFd::every(int ms) {
+    itimerspec its{};
+    its.it_interval.tv_sec = ms / 1000;
+    its.it_interval.tv_nsec = (long)(ms % 1000) * 1000000L;
+    its.it_value = its.it_interval;
+    if (fd_ >= 0) timerfd_settime(fd_, 0, &its, nullptr);
+}
+
+void TimerFd::at(unsigned long long us) {
+    itimerspec its{};
+    its.it_value.tv_sec = (time_t)(us / 1000000ull);
+    its.it_value.tv_nsec = (long)(us % 1000000ull) * 1000L;
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) its.it_value.tv_nsec = 1; // zero would disarm
+    if (fd_ >= 0) timerfd_settime(fd_, TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+void TimerFd::disarm() {
+    itimerspec its{};
+    if (fd_ >= 0) timerfd_settime(fd_, 0, &its, nullptr);
+}
+
+uint64_t TimerFd::consume() {
+    uint64_t n = 0;
+    if (fd_ < 0 || read(fd_, &n, sizeof n) != (ssize_t)sizeof n) return 0;
+    return n;
+}
+
+} // namespace myterm
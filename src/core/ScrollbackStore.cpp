@@ -0,0 +1,280 @@
+#include "core/ScrollbackStore.hpp"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace myterm {
+
+ScrollbackStore::ScrollbackStore(size_t maxLines, size_t maxBytes)
+    : maxLines_(maxLines), maxBytes_(maxBytes) {}
+
+void ScrollbackStore::setLimits(size_t maxLines, size_t maxBytes) {
+    maxLines_ = maxLines;
+    maxBytes_ = maxBytes;
+    enforceLimits();
+}
+
+ScrollbackStore::Chunk& ScrollbackStore::pushChunk(size_t minCap) {
+    if (count_ == ring_.size()) {
+        // Ring full: re-linearize into a larger slot array (moves Chunk headers only, never text)
+        std::vector<Chunk> grown;
+        grown.reserve(std::max<size_t>(4, ring_.size() * 2));
+        for (size_t i = 0; i < count_; ++i) grown.push_back(std::move(chunkAt(i)));
+        grown.resize(grown.capacity());
+        ring_ = std::move(grown);
+        first_ = 0;
+    }
+    Chunk& c = chunkAt(count_);
+    if (minCap == kChunkSize && spare_) c.data = std::move(spare_);
+    else c.data.reset(new char[minCap]);
+    c.cap = minCap;
+    c.head = c.tail = 0;
+    ++count_;
+    return c;
+}
+
+void ScrollbackStore::popFrontChunk() {
+    Chunk& c = chunkAt(0);
+    if (c.cap == kChunkSize && !spare_) spare_ = std::move(c.data);
+    c = Chunk{};
+    first_ = (first_ + 1) % ring_.size();
+    ++frontSeq_;
+    if (--count_ == 0) first_ = 0;
+}
+
+void ScrollbackStore::popBackChunk() {
+    Chunk& c = chunkAt(count_ - 1);
+    if (c.cap == kChunkSize && !spare_) spare_ = std::move(c.data);
+    c = Chunk{};
+    if (--count_ == 0) first_ = 0;
+}
+
+// Copy into the newest chunk (caller guarantees room) and extend the line index.
+void ScrollbackStore::copyIn(std::string_view s) {
+    Chunk& c = chunkAt(count_ - 1);
+    const uint64_t seq = frontSeq_ + count_ - 1;
+    size_t at = c.tail;
+    memcpy(c.data.get() + at, s.data(), s.size());
+    c.tail += s.size();
+    bytes_ += s.size();
+    const char* p = s.data();
+    const char* end = p + s.size();
+    if (open_ && !s.empty()) markDirty(firstLine_ + lines_.size() - 1);
+    while (p < end) {
+        if (!open_) {
+            lines_.push_back(LineRef{seq, (uint32_t)(at + (size_t)(p - s.data())), 0, runsEnd()});
+            open_ = true;
+        }
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+        lines_.back().len += (uint32_t)((nl ? nl : end) - p);
+        if (!nl) break;
+        open_ = false;
+        p = nl + 1;
+    }
+}
+
+// Move the unterminated last line into a chunk with room for `extra` more bytes.
+void ScrollbackStore::relocateOpenLine(size_t extra) {
+    size_t openLen = open_ ? lines_.back().len : 0;
+    size_t need = openLen + extra;
+    size_t cap = need <= kChunkSize ? kChunkSize : need * 2; // oversized lines grow geometrically
+    if (count_ > 0) {
+        Chunk& back = chunkAt(count_ - 1);
+        if (back.tail - back.head == openLen && openLen > 0) {
+            // Chunk holds nothing but the open line: swap in a bigger buffer
+            std::unique_ptr<char[]> buf;
+            if (cap == kChunkSize && spare_) buf = std::move(spare_); else buf.reset(new char[cap]);
+            memcpy(buf.get(), back.data.get() + back.head, openLen);
+            if (back.cap == kChunkSize && !spare_) spare_ = std::move(back.data);
+            back.data = std::move(buf);
+            back.cap = cap;
+            back.head = 0;
+            back.tail = openLen;
+            lines_.back().pos = 0;
+            return;
+        }
+    }
+    Chunk& fresh = pushChunk(cap);
+    if (openLen > 0) {
+        Chunk& prev = chunkAt(count_ - 2);
+        memcpy(fresh.data.get(), prev.data.get() + prev.tail - openLen, openLen);
+        prev.tail -= openLen;
+        fresh.tail = openLen;
+        lines_.back().seq = frontSeq_ + count_ - 1;
+        lines_.back().pos = 0;
+    }
+}
+
+void ScrollbackStore::append(std::string_view s, const StyleRun* runs, size_t nRuns) {
+    // Where the text starts: the end of the open line, or a new line
+    const size_t startLine = open_ ? lines_.size() - 1 : lines_.size();
+    const size_t startCol = open_ ? lines_.back().len : 0;
+    const std::string_view all = s;
+    while (!s.empty()) {
+        Chunk* c = count_ ? &chunkAt(count_ - 1) : nullptr;
+        size_t room = c ? c->cap - c->tail : 0;
+        if (s.size() <= room) { copyIn(s); break; }
+        // Copy the complete lines that still fit; the rest begins a line that does not
+        size_t lastNl = room ? s.substr(0, room).rfind('\n') : std::string_view::npos;
+        if (lastNl != std::string_view::npos) {
+            copyIn(s.substr(0, lastNl + 1));
+            s.remove_prefix(lastNl + 1);
+            continue;
+        }
+        size_t nl = s.find('\n');
+        relocateOpenLine(nl == std::string_view::npos ? s.size() : nl + 1);
+    }
+    if (nRuns > 0 && !all.empty()) addRuns(startLine, startCol, all, runs, nRuns);
+    enforceLimits();
+}
+
+// Split runs given as offsets into s (which was appended starting at line/col) into
+// line-relative runs, and point each line appended with s at its first run.
+void ScrollbackStore::addRuns(size_t line, size_t col, std::string_view s, const StyleRun* runs, size_t nRuns) {
+    size_t li = line;
+    size_t lineStart = 0; // offset in s where line li begins
+    size_t nl = s.find('\n');
+    size_t fixedUpTo = line; // lines_[..fixedUpTo].run are already right
+    size_t lastRunLine = (runsEnd() > lines_[line].run) ? line : (size_t)-1;
+    for (size_t k = 0; k < nRuns; ++k) {
+        size_t a = runs[k].start, b = std::min(s.size(), a + (size_t)runs[k].len);
+        while (a < b) {
+            while (nl != std::string_view::npos && nl < a) { ++li; lineStart = nl + 1; nl = s.find('\n', lineStart); }
+            if (nl == a) { ++a; continue; } // the '\n' itself carries no style
+            size_t e = std::min(b, nl == std::string_view::npos ? s.size() : nl);
+            uint32_t start = (uint32_t)(a - lineStart + (li == line ? col : 0));
+            StyleRun* prev = (lastRunLine == li) ? &runs_.back() : nullptr;
+            if (prev && prev->style == runs[k].style && prev->start + prev->len == start) {
+                prev->len += (uint32_t)(e - a);
+            } else {
+                for (; fixedUpTo < li; ++fixedUpTo) lines_[fixedUpTo + 1].run = runsEnd();
+                runs_.push_back(StyleRun{start, (uint32_t)(e - a), runs[k].style});
+                lastRunLine = li;
+            }
+            a = e;
+        }
+    }
+    for (; fixedUpTo + 1 < lines_.size(); ++fixedUpTo) lines_[fixedUpTo + 1].run = runsEnd();
+}
+
+// Keep only bytes [from, to) of the last line's runs, shifted so `from` becomes 0.
+void ScrollbackStore::clipLastLineRuns(size_t from, size_t to) {
+    const uint64_t first = lines_.back().run;
+    if (runsEnd() == first) return;
+    std::vector<StyleRun> kept;
+    while (runsEnd() > first) {
+        StyleRun r = runs_.back();
+        runs_.pop_back();
+        size_t a = std::max<size_t>(r.start, from), b = std::min<size_t>((size_t)r.start + r.len, to);
+        if (a < b) kept.push_back(StyleRun{(uint32_t)(a - from), (uint32_t)(b - a), r.style});
+    }
+    runs_.insert(runs_.end(), kept.rbegin(), kept.rend());
+}
+
+void ScrollbackStore::lineRuns(size_t i, std::vector<StyleRun>& out) const {
+    out.assign(runs_.begin() + (ptrdiff_t)(lines_[i].run - runsFront_), runs_.begin() + (ptrdiff_t)(runsEndOf(i) - runsFront_));
+}
+
+bool ScrollbackStore::evictFrontLine() {
+    if (lines_.empty() || (open_ && lines_.size() == 1)) return false;
+    // The oldest line starts at the head of the oldest chunk
+    size_t len = (size_t)lines_.front().len + 1;
+    Chunk& c = chunkAt(0);
+    c.head += len;
+    bytes_ -= len;
+    beginOffset_ += len;
+    lines_.pop_front();
+    ++firstLine_;
+    for (uint64_t keep = lines_.empty() ? runsEnd() : lines_.front().run; runsFront_ < keep; ++runsFront_) runs_.pop_front();
+    if (c.head == c.tail) popFrontChunk();
+    return true;
+}
+
+void ScrollbackStore::enforceLimits() {
+    while ((maxLines_ && lineCount() > maxLines_) || (maxBytes_ && bytes_ > maxBytes_)) {
+        if (evictFrontLine()) continue;
+        // Only the unterminated line is left and it alone is over budget (e.g. output
+        // without newlines): keep its newest half, starting on a UTF-8 lead byte.
+        if (maxBytes_ && bytes_ > maxBytes_ && count_ > 0) {
+            Chunk& c = chunkAt(count_ - 1);
+            size_t drop = bytes_ - maxBytes_ / 2;
+            while (drop < bytes_ && ((unsigned char)c.data[c.head + drop] & 0xC0) == 0x80) ++drop;
+            clipLastLineRuns(drop, lines_.back().len);
+            c.head += drop;
+            bytes_ -= drop;
+            beginOffset_ += drop;
+            lines_.back().pos += (uint32_t)drop;
+            lines_.back().len -= (uint32_t)drop;
+            markDirty(firstLine_ + lines_.size() - 1);
+        }
+        break;
+    }
+}
+
+void ScrollbackStore::clear() {
+    while (count_) popFrontChunk();
+    beginOffset_ += bytes_;
+    bytes_ = 0;
+    firstLine_ += lines_.size();
+    markDirty(firstLine_);
+    lines_.clear();
+    runsFront_ += runs_.size();
+    runs_.clear();
+    open_ = false;
+}
+
+void ScrollbackStore::truncate(size_t pos) {
+    if (pos >= endOffset()) return;
+    if (pos <= beginOffset_) { clear(); beginOffset_ = pos; return; }
+    size_t drop = endOffset() - pos;
+    // Lines and chunks both lose the same suffix of the stream
+    for (size_t left = drop; left > 0; ) {
+        LineRef& r = lines_.back();
+        size_t occupied = (size_t)r.len + (open_ ? 0 : 1);
+        if (left >= occupied) {
+            while (runsEnd() > r.run) runs_.pop_back();
+            lines_.pop_back(); open_ = false; left -= occupied; continue;
+        }
+        if (!open_) { open_ = true; --left; } // the cut lands inside this line: it loses its '\n'
+        r.len -= (uint32_t)left;
+        clipLastLineRuns(0, r.len);
+        left = 0;
+    }
+    while (drop > 0) {
+        Chunk& c = chunkAt(count_ - 1);
+        size_t cut = std::min(drop, c.tail - c.head);
+        c.tail -= cut;
+        bytes_ -= cut;
+        drop -= cut;
+        if (c.head == c.tail) popBackChunk();
+    }
+    markDirty(firstLine_ + (lines_.empty() ? 0 : lines_.size() - 1));
+}
+
+void ScrollbackStore::replaceOpenLine(std::string_view s, const StyleRun* runs, size_t nRuns) {
+    if (open_) truncate(endOffset() - lines_.back().len);
+    append(s, runs, nRuns);
+}
+
+void ScrollbackStore::swap(ScrollbackStore& o) noexcept {
+    std::swap(ring_, o.ring_);
+    std::swap(first_, o.first_);
+    std::swap(count_, o.count_);
+    std::swap(spare_, o.spare_);
+    std::swap(frontSeq_, o.frontSeq_);
+    std::swap(lines_, o.lines_);
+    std::swap(open_, o.open_);
+    std::swap(firstLine_, o.firstLine_);
+    std::swap(runs_, o.runs_);
+    std::swap(runsFront_, o.runsFront_);
+    // Both stores now hold different text under their line numbers
+    markDirty(firstLine_);
+    o.markDirty(o.firstLine_);
+    std::swap(bytes_, o.bytes_);
+    std::swap(beginOffset_, o.beginOffset_);
+    // Limits stay with each store; re-apply them to the contents just received
+    enforceLimits();
+    o.enforceLimits();
+}
+
+} // namespace myterm
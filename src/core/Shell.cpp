@@ -0,0 +1,167 @@
+#include "core/Shell.hpp"
+#include "core/Builtins.hpp"
+#include "core/MultiWatch.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace myterm {
+
+static void write_all(int fd, const std::string& s) {
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = write(fd, s.data() + off, s.size() - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        off += (size_t)n;
+    }
+}
+
+static int exit_code(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
+Shell::Shell() {
+    historyPath_ = History::defaultPath();
+    if (!historyPath_.empty()) history_.loadFromFile(historyPath_);
+}
+
+int Shell::runFile(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        write_all(STDERR_FILENO, "myshell: " + path + ": " + strerror(errno) + "\n");
+        return 127;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return run(ss.str());
+}
+
+int Shell::run(const std::string& src) {
+    ParsedScript script = parseShell(src);
+    if (script.incomplete) {
+        write_all(STDERR_FILENO, "myshell: syntax error: unexpected end of file\n");
+        return 2;
+    }
+    if (!script.error.empty()) {
+        write_all(STDERR_FILENO, "myshell: " + script.error + "\n");
+        return 2;
+    }
+    int status = 0;
+    for (const auto& p : script.pipelines) {
+        if (exit_) break;
+        // An and-or list skips the pipelines the last status rules out
+        if (p.join == Connector::And && status != 0) continue;
+        if (p.join == Connector::Or && status == 0) continue;
+        reapJobs();
+        status = runPipeline(p);
+    }
+    return status;
+}
+
+int Shell::runPipeline(const Pipeline& p) {
+    if (p.stages.empty()) return 0;
+    std::vector<std::string> args;
+    for (const auto& w : p.stages[0].words) args.push_back(w.text);
+    if (args.empty() && p.stages.size()==1) {
+        write_all(STDERR_FILENO, "invalid command\n");
+        return 1;
+    }
+    if (!args.empty() && !p.background) {
+        if (args[0]=="exit") {
+            exit_ = true;
+            return args.size()>=2 ? atoi(args[1].c_str()) & 0xff : 0;
+        }
+        if (args[0]=="multiWatch") return runMultiWatch(args);
+        // Piped or redirected, /bin/echo does the job, as in the window
+        bool builtinEcho = p.stages.size()==1 && p.stages[0].redirects.empty();
+        if (args[0]!="echo" || builtinEcho) {
+            ShellContext ctx{history_, historyPath_, commands_, jobs_, nullptr};
+            std::string out, err;
+            int status = 0;
+            if (runBuiltin(ctx, args, out, err, status)) {
+                write_all(STDOUT_FILENO, out);
+                write_all(STDERR_FILENO, err);
+                return status;
+            }
+        }
+    }
+
+    PipelineIo io;
+    int devnull = -1;
+    if (p.background) {
+        devnull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        io.in = devnull;
+    } else {
+        io.ownGroup = false;
+    }
+    LaunchedPipeline lp = launchPipeline(p, io, commands_);
+    if (devnull >= 0) close(devnull);
+    write_all(STDERR_FILENO, lp.errors);
+    if (p.background) {
+        if (lp.last > 0) jobs_.push_back(BackgroundJob{lp.last, lp.pgid, -1, -1, p.text});
+        return lp.last > 0 ? 0 : lp.failStatus;
+    }
+    return wait(lp);
+}
+
+// Wait for every stage; the pipeline's status is the last one's. Like sh, the shell
+// sits out a Ctrl+C that the job receives, then stops if the job died of it.
+int Shell::wait(const LaunchedPipeline& lp) {
+    struct sigaction ign{}, oldInt{}, oldQuit{};
+    ign.sa_handler = SIG_IGN;
+    sigaction(SIGINT, &ign, &oldInt);
+    sigaction(SIGQUIT, &ign, &oldQuit);
+    int last = 0;
+    for (pid_t pid : lp.pids) {
+        int st = 0;
+        while (waitpid(pid, &st, 0) < 0 && errno == EINTR) {}
+        if (pid == lp.last) last = st;
+    }
+    sigaction(SIGINT, &oldInt, nullptr);
+    sigaction(SIGQUIT, &oldQuit, nullptr);
+    if (lp.last < 0) return lp.failStatus;
+    if (WIFSIGNALED(last) && (WTERMSIG(last) == SIGINT || WTERMSIG(last) == SIGQUIT)) exit_ = true;
+    return exit_code(last);
+}
+
+int Shell::runMultiWatch(const std::vector<std::string>& args) {
+    MultiWatchSpec spec;
+    std::string error;
+    if (!parseMultiWatch(args, spec, error)) {
+        write_all(STDERR_FILENO, error + "\n");
+        return 2;
+    }
+    pid_t cpid = fork();
+    if (cpid < 0) {
+        write_all(STDERR_FILENO, std::string("multiWatch: fork() failed: ") + strerror(errno) + "\n");
+        return 1;
+    }
+    if (cpid == 0) myterm::runMultiWatch(spec);
+    LaunchedPipeline lp;
+    lp.pids.push_back(cpid);
+    lp.last = cpid;
+    return wait(lp);
+}
+
+// Collect background jobs that have finished
+void Shell::reapJobs() {
+    int st = 0;
+    pid_t pid;
+    while ((pid = waitpid(-1, &st, WNOHANG)) > 0) {
+        for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+            if (it->pid == pid) { jobs_.erase(it); break; }
+        }
+    }
+}
+
+} // namespace myterm
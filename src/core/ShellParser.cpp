@@ -0,0 +1,318 @@
+#include "core/ShellParser.hpp"
+#include <cctype>
+#include <cstdlib>
+
+namespace myterm {
+
+namespace {
+
+enum class Tok { Word, Pipe, AndIf, OrIf, Amp, Semi, Newline, Redir, End };
+
+struct Token {
+    Tok kind = Tok::End;
+    Word word;
+    Redirect redir;  // op and fd; the target is the word that follows
+    size_t begin = 0, end = 0;
+};
+
+static bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static bool is_delim(char c) {
+    return is_blank(c) || c == '\n' || c == ';' || c == '&' || c == '|' || c == '<' || c == '>';
+}
+
+static bool is_name_char(char c) { return isalnum((unsigned char)c) || c == '_'; }
+
+// Characters a word can take over as they are, in runs
+static bool is_plain(char c) {
+    static const struct Table {
+        bool plain[256];
+        Table() {
+            for (int i = 0; i < 256; ++i) plain[i] = true;
+            for (unsigned char c : std::string(" \t\r\n;&|<>\\'\"$~*?[")) plain[c] = false;
+        }
+    } table;
+    return table.plain[(unsigned char)c];
+}
+
+// Hands out one token at a time; words are unquoted and expanded as they are scanned
+class Lexer {
+public:
+    explicit Lexer(const std::string& s) : s_(s) {}
+    bool unterminated() const { return unterminated_; }
+    void next(Token& t);
+
+private:
+    void redirect(Token& t, int fd);
+    void variable(std::string& out); // at '$'
+
+    const std::string& s_;
+    size_t i_ = 0;
+    bool unterminated_ = false;
+    std::string name_; // variable name scratch
+};
+
+void Lexer::next(Token& t) {
+    const size_t n = s_.size();
+    for (;;) {
+        while (i_ < n && is_blank(s_[i_])) ++i_;
+        if (i_ + 1 < n && s_[i_] == '\\' && s_[i_ + 1] == '\n') { i_ += 2; continue; }
+        if (i_ < n && s_[i_] == '#') {
+            while (i_ < n && s_[i_] != '\n') ++i_;
+        }
+        break;
+    }
+    t.begin = i_;
+    t.word.text.clear();
+    t.word.glob = false;
+    if (i_ >= n) { t.kind = Tok::End; t.end = i_; return; }
+    const char c = s_[i_];
+    const char c1 = i_ + 1 < n ? s_[i_ + 1] : '\0';
+    switch (c) {
+        case '\n': t.kind = Tok::Newline; ++i_; t.end = i_; return;
+        case ';':  t.kind = Tok::Semi; ++i_; t.end = i_; return;
+        case '|':
+            if (c1 == '|') { t.kind = Tok::OrIf; i_ += 2; } else { t.kind = Tok::Pipe; ++i_; }
+            t.end = i_;
+            return;
+        case '&':
+            if (c1 == '&') { t.kind = Tok::AndIf; i_ += 2; } else { t.kind = Tok::Amp; ++i_; }
+            t.end = i_;
+            return;
+        case '<': redirect(t, 0); return;
+        case '>': redirect(t, 1); return;
+        default: break;
+    }
+
+    std::string& text = t.word.text;
+    bool quoted = false;
+    while (i_ < n) {
+        size_t run = i_;
+        while (run < n && is_plain(s_[run])) ++run;
+        if (run > i_) { text.append(s_, i_, run - i_); i_ = run; continue; }
+        const char ch = s_[i_];
+        if (ch == '<' || ch == '>') {
+            // Digits right before a redirection name the descriptor: 2>file
+            bool digits = !quoted && !text.empty() && text.size() <= 2;
+            for (char d : text) if (!isdigit((unsigned char)d)) digits = false;
+            if (digits) { redirect(t, atoi(text.c_str())); return; }
+            break;
+        }
+        if (is_delim(ch)) break;
+        if (ch == '\\') {
+            if (i_ + 1 >= n) { ++i_; break; }
+            if (s_[i_ + 1] != '\n') text.push_back(s_[i_ + 1]);
+            quoted = true;
+            i_ += 2;
+            continue;
+        }
+        if (ch == '\'') {
+            size_t close = s_.find('\'', i_ + 1);
+            quoted = true;
+            if (close == std::string::npos) { unterminated_ = true; text.append(s_, i_ + 1, std::string::npos); i_ = n; break; }
+            text.append(s_, i_ + 1, close - i_ - 1);
+            i_ = close + 1;
+            continue;
+        }
+        if (ch == '"') {
+            quoted = true;
+            ++i_;
+            while (i_ < n && s_[i_] != '"') {
+                if (s_[i_] == '\\' && i_ + 1 < n) {
+                    char e = s_[i_ + 1];
+                    // Only these lose their backslash inside double quotes; "\n" stays for echo
+                    if (e == '"' || e == '\\' || e == '$' || e == '`' || e == '\n') {
+                        if (e != '\n') text.push_back(e);
+                        i_ += 2;
+                        continue;
+                    }
+                }
+                if (s_[i_] == '$') { variable(text); continue; }
+                text.push_back(s_[i_++]);
+            }
+            if (i_ >= n) { unterminated_ = true; break; }
+            ++i_;
+            continue;
+        }
+        if (ch == '$') { variable(text); continue; }
+        if (ch == '~' && text.empty() && !quoted && (i_ + 1 >= n || s_[i_ + 1] == '/' || is_delim(s_[i_ + 1]))) {
+            const char* home = getenv("HOME");
+            text += home ? home : "";
+            ++i_;
+            continue;
+        }
+        if (ch == '*' || ch == '?' || ch == '[') t.word.glob = true;
+        text.push_back(ch);
+        ++i_;
+    }
+    // An unquoted expansion that came out empty is no word at all
+    if (text.empty() && !quoted) { next(t); return; }
+    t.kind = Tok::Word;
+    t.end = i_;
+}
+
+void Lexer::redirect(Token& t, int fd) {
+    const size_t n = s_.size();
+    const char c = s_[i_];
+    const char c1 = i_ + 1 < n ? s_[i_ + 1] : '\0';
+    t.kind = Tok::Redir;
+    t.redir = Redirect{};
+    t.redir.fd = fd;
+    if (c1 == '&') { t.redir.op = Redirect::Dup; i_ += 2; }
+    else if (c == '>' && c1 == '>') { t.redir.op = Redirect::Append; i_ += 2; }
+    else if (c == '>' && c1 == '|') { t.redir.op = Redirect::Write; i_ += 2; }
+    else { t.redir.op = c == '<' ? Redirect::Read : Redirect::Write; ++i_; }
+    t.end = i_;
+}
+
+void Lexer::variable(std::string& out) {
+    const size_t n = s_.size();
+    size_t j = i_ + 1;
+    std::string& name = name_;
+    if (j < n && s_[j] == '{') {
+        size_t close = s_.find('}', j);
+        if (close == std::string::npos) { out.push_back('$'); ++i_; return; }
+        name.assign(s_, j + 1, close - j - 1);
+        i_ = close + 1;
+    } else {
+        while (j < n && is_name_char(s_[j])) ++j;
+        if (j == i_ + 1) { out.push_back('$'); ++i_; return; }
+        name.assign(s_, i_ + 1, j - i_ - 1);
+        i_ = j;
+    }
+    if (const char* v = getenv(name.c_str())) out += v;
+}
+
+static const char* token_name(Tok k) {
+    switch (k) {
+        case Tok::Pipe: return "|";
+        case Tok::AndIf: return "&&";
+        case Tok::OrIf: return "||";
+        case Tok::Amp: return "&";
+        case Tok::Semi: return ";";
+        case Tok::Redir: return "redirection";
+        case Tok::Word: return "word";
+        case Tok::Newline:
+        case Tok::End: break;
+    }
+    return "newline";
+}
+
+//   script   := (and_or ((';' | '&') and_or?)* )? (newline script)?
+//   and_or   := pipeline (('&&' | '||') newline* pipeline)*
+//   pipeline := command ('|' newline* command)*
+//   command  := (word | redirect)+
+class Parser {
+public:
+    Parser(const std::string& s, ParsedScript& out) : s_(s), lex_(s), out_(out) {}
+
+    void parse() {
+        advance();
+        while (ok()) {
+            if (tok_.kind == Tok::End) { closeLine(s_.size()); break; }
+            if (tok_.kind == Tok::Newline) { closeLine(tok_.begin); advance(); continue; }
+            if (lineBegin_ == std::string::npos) lineBegin_ = tok_.begin;
+            if (!andOr()) break;
+            if (tok_.kind == Tok::Semi || tok_.kind == Tok::Amp) {
+                if (tok_.kind == Tok::Amp) out_.pipelines.back().background = true;
+                advance();
+            } else if (tok_.kind != Tok::Newline && tok_.kind != Tok::End) {
+                unexpected();
+            }
+        }
+        if (lex_.unterminated()) { out_.incomplete = true; out_.error.clear(); }
+    }
+
+private:
+    bool ok() const { return out_.error.empty() && !out_.incomplete; }
+
+    void advance() {
+        lastEnd_ = tok_.end;
+        lex_.next(tok_);
+    }
+
+    void unexpected() {
+        if (tok_.kind == Tok::End) { out_.incomplete = true; return; }
+        out_.error = std::string("syntax error near unexpected token `") + token_name(tok_.kind) + "'";
+    }
+
+    void skipNewlines() {
+        while (tok_.kind == Tok::Newline) advance();
+    }
+
+    void closeLine(size_t end) {
+        if (lineBegin_ == std::string::npos) return;
+        while (end > lineBegin_ && isspace((unsigned char)s_[end - 1])) --end;
+        out_.lines.emplace_back(s_, lineBegin_, end - lineBegin_);
+        lineBegin_ = std::string::npos;
+    }
+
+    bool andOr() {
+        Connector join = Connector::Seq;
+        for (;;) {
+            if (!pipeline(join)) return false;
+            if (tok_.kind != Tok::AndIf && tok_.kind != Tok::OrIf) return true;
+            join = tok_.kind == Tok::AndIf ? Connector::And : Connector::Or;
+            advance();
+            skipNewlines();
+        }
+    }
+
+    bool pipeline(Connector join) {
+        Pipeline p;
+        p.join = join;
+        p.line = out_.lines.size();
+        const size_t begin = tok_.begin;
+        for (;;) {
+            SimpleCommand cmd;
+            while (tok_.kind == Tok::Word || tok_.kind == Tok::Redir) {
+                if (tok_.kind == Tok::Word) {
+                    cmd.words.push_back(std::move(tok_.word));
+                    advance();
+                    continue;
+                }
+                Redirect r = tok_.redir;
+                advance();
+                if (tok_.kind == Tok::End) { out_.error = "syntax error near unexpected token `newline'"; return false; }
+                if (tok_.kind != Tok::Word) { unexpected(); return false; }
+                if (r.op == Redirect::Dup) {
+                    const std::string& w = tok_.word.text;
+                    if (w.empty() || w.size() > 2 || !isdigit((unsigned char)w[0]) || (w.size() == 2 && !isdigit((unsigned char)w[1]))) {
+                        out_.error = "bad file descriptor `" + w + "'";
+                        return false;
+                    }
+                    r.dupFd = atoi(w.c_str());
+                } else {
+                    r.target = std::move(tok_.word.text);
+                }
+                cmd.redirects.push_back(std::move(r));
+                advance();
+            }
+            if (cmd.words.empty() && cmd.redirects.empty()) { unexpected(); return false; }
+            p.stages.push_back(std::move(cmd));
+            if (tok_.kind != Tok::Pipe) break;
+            advance();
+            skipNewlines();
+        }
+        p.text.assign(s_, begin, lastEnd_ - begin);
+        out_.pipelines.push_back(std::move(p));
+        return true;
+    }
+
+    const std::string& s_;
+    Lexer lex_;
+    ParsedScript& out_;
+    Token tok_;
+    size_t lastEnd_ = 0;                       // end of the last token consumed
+    size_t lineBegin_ = std::string::npos;     // start of the current command line
+};
+
+} // namespace
+
+ParsedScript parseShell(const std::string& src) {
+    ParsedScript out;
+    Parser(src, out).parse();
+    return out;
+}
+
+} // namespace myterm
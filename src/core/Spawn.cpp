@@ -0,0 +1,82 @@
+#include "core/Spawn.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+extern char** environ;
+
+namespace myterm {
+
+Spawn::Spawn() {
+    posix_spawn_file_actions_init(&actions_);
+    posix_spawnattr_init(&attr_);
+    // Nothing the GUI ignores or blocks (SIGPIPE, SIGCHLD for the reaper) carries over
+    sigset_t set;
+    sigfillset(&set);
+    posix_spawnattr_setsigdefault(&attr_, &set);
+    sigemptyset(&set);
+    posix_spawnattr_setsigmask(&attr_, &set);
+    flags_ = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+}
+
+Spawn::~Spawn() {
+    posix_spawnattr_destroy(&attr_);
+    posix_spawn_file_actions_destroy(&actions_);
+}
+
+void Spawn::dup2(int fd, int target) {
+    posix_spawn_file_actions_adddup2(&actions_, fd, target);
+}
+
+void Spawn::open(int target, const std::string& path, int flags, mode_t mode) {
+    posix_spawn_file_actions_addopen(&actions_, target, path.c_str(), flags, mode);
+}
+
+void Spawn::setProcessGroup(pid_t pgid) {
+    posix_spawnattr_setpgroup(&attr_, pgid);
+    flags_ |= POSIX_SPAWN_SETPGROUP;
+}
+
+void Spawn::newSession() {
+#ifdef POSIX_SPAWN_SETSID
+    flags_ = (short)((flags_ & ~POSIX_SPAWN_SETPGROUP) | POSIX_SPAWN_SETSID);
+#else
+    // No session support (glibc before 2.26): at least keep it out of our group
+    setProcessGroup(0);
+#endif
+}
+
+void Spawn::setEnv(const std::string& name, const std::string& value) {
+    env_.emplace_back(name, value);
+}
+
+pid_t Spawn::run(const std::vector<std::string>& argv, const std::string& path) {
+    if (argv.empty()) { errno = EINVAL; return -1; }
+    std::vector<char*> cargv;
+    cargv.reserve(argv.size() + 1);
+    for (auto& s : argv) cargv.push_back(const_cast<char*>(s.c_str()));
+    cargv.push_back(nullptr);
+
+    // environ with the overrides replacing (or added after) the inherited entries
+    std::vector<std::string> extra;
+    std::vector<char*> envp;
+    for (auto& kv : env_) extra.push_back(kv.first + "=" + kv.second);
+    for (char** e = environ; e && *e; ++e) {
+        bool overridden = false;
+        for (auto& kv : env_) {
+            if (strncmp(*e, kv.first.c_str(), kv.first.size()) == 0 && (*e)[kv.first.size()] == '=') overridden = true;
+        }
+        if (!overridden) envp.push_back(*e);
+    }
+    for (auto& s : extra) envp.push_back(const_cast<char*>(s.c_str()));
+    envp.push_back(nullptr);
+
+    posix_spawnattr_setflags(&attr_, flags_);
+    pid_t pid = -1;
+    int err = path.empty() ? posix_spawnp(&pid, cargv[0], &actions_, &attr_, cargv.data(), envp.data())
+                           : posix_spawn(&pid, path.c_str(), &actions_, &attr_, cargv.data(), envp.data());
+    if (err != 0) { errno = err; return -1; }
+    return pid;
+}
+
+} // namespace myterm
@@ -0,0 +1,72 @@
+#include "core/TextStyle.hpp"
+#include <algorithm>
+
+namespace myterm {
+
+void StyledText::append(const char* s, size_t n, const TextStyle& st) {
+    if (n == 0) return;
+    size_t at = text.size();
+    text.append(s, n);
+    if (st.isDefault()) return;
+    if (!runs.empty() && runs.back().style == st && runs.back().start + runs.back().len == at) {
+        runs.back().len += (uint32_t)n;
+        return;
+    }
+    runs.push_back(StyleRun{(uint32_t)at, (uint32_t)n, st});
+}
+
+// Nearest xterm-256 entry for a 24-bit color (cube or grayscale ramp)
+static uint16_t rgb_to_palette(int r, int g, int b) {
+    auto level = [](int v) { return v < 48 ? 0 : v < 115 ? 1 : (v - 35) / 40; };
+    auto value = [](int l) { return l ? 55 + l * 40 : 0; };
+    int lr = level(r), lg = level(g), lb = level(b);
+    int cr = value(lr), cg = value(lg), cb = value(lb);
+    int avg = (r + g + b) / 3;
+    int grayIdx = avg > 238 ? 23 : std::max(0, (avg - 3) / 10);
+    int gv = 8 + grayIdx * 10;
+    auto dist = [](int r1, int g1, int b1, int r2, int g2, int b2) {
+        return (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2);
+    };
+    if (dist(r, g, b, gv, gv, gv) < dist(r, g, b, cr, cg, cb)) return (uint16_t)(232 + grayIdx);
+    return (uint16_t)(16 + 36 * lr + 6 * lg + lb);
+}
+
+void applySgr(TextStyle& pen, const int* params, size_t n) {
+    if (n == 0) { pen = TextStyle{}; return; }
+    for (size_t i = 0; i < n; ++i) {
+        int code = params[i];
+        if (code == 0) pen = TextStyle{};
+        else if (code == 1) pen.flags |= TextStyle::Bold;
+        else if (code == 2) pen.flags |= TextStyle::Dim;
+        else if (code == 3) pen.flags |= TextStyle::Italic;
+        else if (code == 4) pen.flags |= TextStyle::Underline;
+        else if (code == 7) pen.flags |= TextStyle::Inverse;
+        else if (code == 9) pen.flags |= TextStyle::Strike;
+        else if (code == 22) pen.flags &= (uint8_t)~(TextStyle::Bold | TextStyle::Dim);
+        else if (code == 23) pen.flags &= (uint8_t)~TextStyle::Italic;
+        else if (code == 24) pen.flags &= (uint8_t)~TextStyle::Underline;
+        else if (code == 27) pen.flags &= (uint8_t)~TextStyle::Inverse;
+        else if (code == 29) pen.flags &= (uint8_t)~TextStyle::Strike;
+        else if (code >= 30 && code <= 37) pen.fg = (uint16_t)(code - 30);
+        else if (code == 39) pen.fg = TextStyle::kDefaultColor;
+        else if (code >= 40 && code <= 47) pen.bg = (uint16_t)(code - 40);
+        else if (code == 49) pen.bg = TextStyle::kDefaultColor;
+        else if (code >= 90 && code <= 97) pen.fg = (uint16_t)(code - 82); // bright
+        else if (code >= 100 && code <= 107) pen.bg = (uint16_t)(code - 92);
+        else if (code == 38 || code == 48) {
+            uint16_t* target = code == 38 ? &pen.fg : &pen.bg;
+            if (i + 2 < n && params[i + 1] == 5) {
+                *target = (uint16_t)std::clamp(params[i + 2], 0, 255);
+                i += 2;
+            } else if (i + 4 < n && params[i + 1] == 2) {
+                *target = rgb_to_palette(std::clamp(params[i + 2], 0, 255), std::clamp(params[i + 3], 0, 255),
+                                         std::clamp(params[i + 4], 0, 255));
+                i += 4;
+            } else {
+                break; // malformed extended color: ignore the rest
+            }
+        }
+    }
+}
+
+} // namespace myterm
@@ -0,0 +1,108 @@
+#include "core/VtParser.hpp"
+#include <algorithm>
+
+namespace myterm {
+
+static constexpr size_t kMaxOsc = 4096;
+
+void VtParser::reset() {
+    state_ = State::Ground;
+    nParams_ = 0;
+    paramOpen_ = false;
+    prefix_ = inter_ = 0;
+    osc_.clear();
+}
+
+void VtParser::beginCsi() {
+    state_ = State::Csi;
+    nParams_ = 0;
+    params_[0] = 0;
+    paramOpen_ = false;
+    prefix_ = inter_ = 0;
+}
+
+void VtParser::dispatchCsi(char final, Handler& h) {
+    size_t n = nParams_;
+    if (paramOpen_ && n < kMaxParams) ++n; // close the last parameter
+    h.csi(params_, n, prefix_, inter_, final);
+    state_ = State::Ground;
+}
+
+void VtParser::feed(const char* data, size_t n, Handler& h) {
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)data[i];
+        // CAN/SUB abort any sequence; ESC restarts one (except inside strings, handled below)
+        if (c == 0x18 || c == 0x1A) { state_ = State::Ground; continue; }
+        switch (state_) {
+        case State::Ground: {
+            if (c >= 0x20 && c != 0x7F) {
+                // Hand over the whole printable stretch at once
+                size_t j = i + 1;
+                while (j < n && (unsigned char)data[j] >= 0x20 && (unsigned char)data[j] != 0x7F) ++j;
+                h.print(std::string_view(data + i, j - i));
+                i = j - 1;
+            } else if (c == 0x1B) {
+                state_ = State::Escape;
+                inter_ = 0;
+            } else if (c < 0x20) {
+                h.execute((char)c);
+            }
+            break;
+        }
+        case State::Escape:
+        case State::EscapeInter:
+            if (c == 0x1B) { state_ = State::Escape; inter_ = 0; }
+            else if (c < 0x20) h.execute((char)c);
+            else if (c >= 0x20 && c <= 0x2F) { inter_ = (char)c; state_ = State::EscapeInter; }
+            else if (state_ == State::Escape && c == '[') beginCsi();
+            else if (state_ == State::Escape && c == ']') { osc_.clear(); state_ = State::Osc; }
+            else if (state_ == State::Escape && (c == 'P' || c == 'X' || c == '^' || c == '_')) state_ = State::String;
+            else if (c != 0x7F) { h.esc(inter_, (char)c); state_ = State::Ground; }
+            break;
+        case State::Csi:
+            if (c == 0x1B) { state_ = State::Escape; inter_ = 0; }
+            else if (c < 0x20) h.execute((char)c);
+            else if (c >= '0' && c <= '9') {
+                if (nParams_ < kMaxParams) params_[nParams_] = std::min(params_[nParams_] * 10 + (c - '0'), 65535);
+                paramOpen_ = true;
+            } else if (c == ';' || c == ':') {
+                if (nParams_ < kMaxParams) ++nParams_;
+                if (nParams_ < kMaxParams) params_[nParams_] = 0;
+                paramOpen_ = true;
+            } else if (c >= '<' && c <= '?') {
+                // Private marker is only valid before any parameter
+                if (nParams_ == 0 && !paramOpen_ && !prefix_) prefix_ = (char)c; else state_ = State::CsiIgnore;
+            } else if (c >= 0x20 && c <= 0x2F) {
+                inter_ = (char)c;
+            } else if (c >= 0x40 && c <= 0x7E) {
+                dispatchCsi((char)c, h);
+            }
+            break;
+        case State::CsiIgnore:
+            if (c == 0x1B) { state_ = State::Escape; inter_ = 0; }
+            else if (c < 0x20) h.execute((char)c);
+            else if (c >= 0x40 && c <= 0x7E) state_ = State::Ground;
+            break;
+        case State::Osc:
+            if (c == 0x07) { h.osc(osc_); state_ = State::Ground; }
+            else if (c == 0x1B) state_ = State::OscEsc;
+            else if (c >= 0x20 && osc_.size() < kMaxOsc) osc_.push_back((char)c);
+            break;
+        case State::OscEsc:
+            // ST is ESC '\'; anything else ends the string too and starts a new escape
+            h.osc(osc_);
+            state_ = State::Ground;
+            if (c != '\\') { state_ = State::Escape; inter_ = 0; --i; }
+            break;
+        case State::String: // DCS/SOS/PM/APC payloads are ignored
+            if (c == 0x07) state_ = State::Ground;
+            else if (c == 0x1B) state_ = State::StringEsc;
+            break;
+        case State::StringEsc:
+            state_ = (c == '\\') ? State::Ground : State::String;
+            break;
+        }
+    }
+}
+
+} // namespace myterm
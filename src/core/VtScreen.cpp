@@ -0,0 +1,559 @@
+#include "core/VtScreen.hpp"
+#include <cstdio>
+
+namespace myterm {
+
+bool isCombining(char32_t cp) {
+    return (cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x1AB0 && cp <= 0x1AFF) || (cp >= 0x1DC0 && cp <= 0x1DFF) ||
+           (cp >= 0x20D0 && cp <= 0x20FF) || (cp >= 0xFE00 && cp <= 0xFE0F) || (cp >= 0xFE20 && cp <= 0xFE2F);
+}
+
+// Length of the UTF-8 sequence starting with lead byte c (1 for stray/invalid bytes)
+static size_t utf8_len(unsigned char c) {
+    if (c < 0xC0) return 1;
+    if (c < 0xE0) return 2;
+    if (c < 0xF0) return 3;
+    if (c < 0xF8) return 4;
+    return 1;
+}
+
+// Decode the code point at s[i] (U+FFFD for malformed input) and advance i past it
+static char32_t utf8_next(std::string_view s, size_t& i) {
+    unsigned char c = (unsigned char)s[i];
+    size_t len = utf8_len(c);
+    if (len == 1 || i + len > s.size()) { ++i; return c < 0x80 ? (char32_t)c : U'\uFFFD'; }
+    char32_t cp = c & (0x7F >> len);
+    for (size_t k = 1; k < len; ++k) {
+        unsigned char cc = (unsigned char)s[i + k];
+        if ((cc & 0xC0) != 0x80) { ++i; return U'\uFFFD'; }
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    i += len;
+    return cp;
+}
+
+static void utf8_put(std::string& out, char32_t cp) {
+    if (cp < 0x80) out += (char)cp;
+    else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 0x3F)); }
+    else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18)); out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F)); out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+size_t cellCount(std::string_view s) {
+    size_t cells = 0;
+    for (size_t i = 0; i < s.size(); ) {
+        if ((unsigned char)s[i] < 0x80) { ++cells; ++i; continue; }
+        if (!isCombining(utf8_next(s, i))) ++cells;
+    }
+    return cells;
+}
+
+// Byte offset where cell `cell` of s begins (s.size() past the end)
+static size_t cell_offset(std::string_view s, size_t cell) {
+    size_t i = 0;
+    for (size_t seen = 0; i < s.size(); ) {
+        size_t at = i;
+        char32_t cp = (unsigned char)s[i] < 0x80 ? (char32_t)s[i++] : utf8_next(s, i);
+        if (isCombining(cp)) continue;
+        if (seen++ == cell) return at;
+    }
+    return s.size();
+}
+
+// Append bytes [a, b) of a stored line to out, keeping their style
+static void append_slice(StyledText& out, std::string_view line, const std::vector<StyleRun>& runs, size_t a, size_t b) {
+    static const TextStyle plain;
+    for (const StyleRun& r : runs) {
+        size_t ra = std::max<size_t>(r.start, a), rb = std::min<size_t>((size_t)r.start + r.len, b);
+        if (ra >= rb) continue;
+        if (a < ra) out.append(line.data() + a, ra - a, plain);
+        out.append(line.data() + ra, rb - ra, r.style);
+        a = rb;
+    }
+    if (a < b) out.append(line.data() + a, b - a, plain);
+}
+
+VtScreen::VtScreen(ScrollbackStore& primary) : store_(primary) {
+    resize(cols_, rows_);
+    syncPrimary();
+}
+
+void VtScreen::feed(const char* data, size_t n) {
+    syncPrimary();
+    parser_.feed(data, n, *this);
+    flushPending();
+}
+
+void VtScreen::reset() {
+    flushPending();
+    parser_.reset();
+    if (alt_) setAlt(false, false);
+    pen_ = TextStyle{};
+    savedPen_ = TextStyle{};
+    top_ = 0;
+    bottom_ = rows_ - 1;
+    originMode_ = insertMode_ = appCursorKeys_ = false;
+    autoWrap_ = cursorVisible_ = true;
+    utf8Carry_.clear();
+    syncBegin_ = syncEnd_ = (size_t)-1; // re-read the open line on the next feed
+    syncPrimary();
+}
+
+void VtScreen::resize(int cols, int rows) {
+    cols = std::max(cols, 1);
+    rows = std::max(rows, 1);
+    if (cols == cols_ && rows == rows_ && !grid_.empty()) return;
+    // Keep the top-left of the old grid; full-screen programs repaint after SIGWINCH anyway
+    std::vector<Cell> grid((size_t)cols * (size_t)rows);
+    for (int r = 0; r < std::min(rows, rows_) && !grid_.empty(); ++r)
+        for (int c = 0; c < std::min(cols, cols_); ++c) grid[(size_t)r * (size_t)cols + (size_t)c] = at(r, c);
+    grid_.swap(grid);
+    cols_ = cols;
+    rows_ = rows;
+    dirty_.assign((size_t)rows, 1);
+    stale_.assign((size_t)rows, 1);
+    rowCache_.resize((size_t)rows);
+    row_ = std::min(row_, rows_ - 1);
+    col_ = std::min(col_, cols_ - 1);
+    savedRow_ = std::min(savedRow_, rows_ - 1);
+    savedCol_ = std::min(savedCol_, cols_ - 1);
+    top_ = 0;
+    bottom_ = rows_ - 1;
+}
+
+const StyledText& VtScreen::rowText(int row) {
+    StyledText& t = rowCache_[(size_t)row];
+    if (!stale_[(size_t)row]) return t;
+    stale_[(size_t)row] = 0;
+    t.text.clear();
+    t.runs.clear();
+    // Trailing blanks in the default style are not drawn
+    int end = cols_;
+    while (end > 0) {
+        const Cell& c = cell(row, end - 1);
+        if (c.ch != U' ' || c.comb || !c.style.isDefault()) break;
+        --end;
+    }
+    std::string glyph;
+    for (int c = 0; c < end; ++c) {
+        const Cell& cl = cell(row, c);
+        glyph.clear();
+        utf8_put(glyph, cl.ch);
+        if (cl.comb) utf8_put(glyph, cl.comb);
+        t.append(glyph.data(), glyph.size(), cl.style);
+    }
+    return t;
+}
+
+void VtScreen::clearDirty() {
+    std::fill(dirty_.begin(), dirty_.end(), 0);
+}
+
+// ---- Primary screen ----
+
+void VtScreen::recordSync() {
+    syncBegin_ = store_.beginOffset();
+    syncEnd_ = store_.endOffset();
+    syncFirst_ = store_.firstLine();
+    syncLines_ = store_.lineCount();
+}
+
+// Someone else (the shell's own prompt and messages) may have written to the
+// store since our last write; the cursor then sits at the end of the last line.
+void VtScreen::syncPrimary() {
+    if (store_.beginOffset() == syncBegin_ && store_.endOffset() == syncEnd_ && store_.firstLine() == syncFirst_ &&
+        store_.lineCount() == syncLines_) return;
+    lineCells_ = store_.lastLineOpen() ? cellCount(store_.line(store_.lineCount() - 1)) : 0;
+    col0_ = lineCells_;
+    recordSync();
+}
+
+void VtScreen::flushPending() {
+    if (pending_.empty()) return;
+    store_.append(pending_);
+    pending_.text.clear();
+    pending_.runs.clear();
+    recordSync();
+}
+
+// Replace cells [fromCell, toCell) of the open line with repl drawn in the current pen
+void VtScreen::spliceLine(size_t fromCell, size_t toCell, std::string_view repl) {
+    flushPending();
+    std::string_view line;
+    lineRuns_.clear();
+    if (store_.lastLineOpen()) {
+        line = store_.line(store_.lineCount() - 1);
+        store_.lineRuns(store_.lineCount() - 1, lineRuns_);
+    }
+    size_t a = cell_offset(line, fromCell), b = std::max(a, cell_offset(line, toCell));
+    edit_.text.clear();
+    edit_.runs.clear();
+    append_slice(edit_, line, lineRuns_, 0, a);
+    if (fromCell > lineCells_) edit_.append(std::string(fromCell - lineCells_, ' ').data(), fromCell - lineCells_, TextStyle{});
+    edit_.append(repl.data(), repl.size(), pen_);
+    append_slice(edit_, line, lineRuns_, b, line.size());
+    store_.replaceOpenLine(edit_.text, edit_.runs.data(), edit_.runs.size());
+    lineCells_ = cellCount(edit_.text);
+    recordSync();
+}
+
+void VtScreen::printPrimary(std::string_view text) {
+    size_t cells = cellCount(text);
+    if (col0_ < lineCells_) {
+        spliceLine(col0_, col0_ + cells, text); // overwrite
+    } else {
+        if (col0_ > lineCells_) pending_.append(std::string(col0_ - lineCells_, ' ').data(), col0_ - lineCells_, TextStyle{});
+        pending_.append(text.data(), text.size(), pen_);
+        lineCells_ = col0_ + cells;
+    }
+    col0_ += cells;
+}
+
+void VtScreen::saveCursor() {
+    savedRow_ = row_;
+    savedCol_ = std::min(col_, cols_ - 1);
+    savedCol0_ = col0_;
+    savedPen_ = pen_;
+}
+
+void VtScreen::restoreCursor() {
+    if (alt_) {
+        row_ = savedRow_;
+        col_ = savedCol_;
+    } else {
+        col0_ = savedCol0_;
+    }
+    pen_ = savedPen_;
+}
+
+// ---- Alternate screen ----
+
+void VtScreen::setAlt(bool on, bool saveRestore) {
+    if (on == alt_) return;
+    if (on) {
+        flushPending();
+        if (saveRestore) saveCursor();
+        alt_ = true;
+        std::fill(grid_.begin(), grid_.end(), Cell{});
+        row_ = col_ = 0;
+        top_ = 0;
+        bottom_ = rows_ - 1;
+        markAllDirty();
+    } else {
+        alt_ = false;
+        if (saveRestore) pen_ = savedPen_;
+        top_ = 0;
+        bottom_ = rows_ - 1;
+    }
+}
+
+VtScreen::Cell VtScreen::blank() const {
+    // Erased cells take the current background (xterm's back-color-erase)
+    Cell c;
+    c.style.bg = pen_.bg;
+    return c;
+}
+
+void VtScreen::markAllDirty() {
+    std::fill(dirty_.begin(), dirty_.end(), 1);
+    std::fill(stale_.begin(), stale_.end(), 1);
+}
+
+void VtScreen::putChar(char32_t cp) {
+    if (isCombining(cp)) {
+        int c = std::min(col_, cols_) - 1;
+        if (c >= 0 && !at(row_, c).comb) { at(row_, c).comb = cp; markDirty(row_); }
+        return;
+    }
+    if (col_ >= cols_) { // deferred wrap from the previous character
+        col_ = 0;
+        lineFeed();
+    }
+    if (insertMode_) std::move_backward(&at(row_, col_), &at(row_, cols_ - 1), &at(row_, cols_ - 1) + 1);
+    Cell& c = at(row_, col_);
+    c.ch = cp;
+    c.comb = 0;
+    c.style = pen_;
+    markDirty(row_);
+    if (col_ < cols_ - 1 || autoWrap_) ++col_;
+}
+
+void VtScreen::lineFeed() {
+    if (row_ == bottom_) scrollUp(top_, bottom_, 1);
+    else if (row_ < rows_ - 1) ++row_;
+}
+
+// Move rows [top, bottom] up by n, blanking the n rows that open at the bottom.
+// Cached row text moves with its row, so only the fresh rows are rebuilt.
+void VtScreen::scrollUp(int top, int bottom, int n) {
+    n = std::min(n, bottom - top + 1);
+    if (n <= 0) return;
+    auto rowIt = [&](int r) { return grid_.begin() + (ptrdiff_t)r * cols_; };
+    std::move(rowIt(top + n), rowIt(bottom + 1), rowIt(top));
+    std::fill(rowIt(bottom + 1 - n), rowIt(bottom + 1), blank());
+    std::rotate(rowCache_.begin() + top, rowCache_.begin() + top + n, rowCache_.begin() + bottom + 1);
+    std::rotate(stale_.begin() + top, stale_.begin() + top + n, stale_.begin() + bottom + 1);
+    for (int r = top; r <= bottom; ++r) dirty_[(size_t)r] = 1;
+    for (int r = bottom + 1 - n; r <= bottom; ++r) stale_[(size_t)r] = 1;
+}
+
+void VtScreen::scrollDown(int top, int bottom, int n) {
+    n = std::min(n, bottom - top + 1);
+    if (n <= 0) return;
+    auto rowIt = [&](int r) { return grid_.begin() + (ptrdiff_t)r * cols_; };
+    std::move_backward(rowIt(top), rowIt(bottom + 1 - n), rowIt(bottom + 1));
+    std::fill(rowIt(top), rowIt(top + n), blank());
+    std::rotate(rowCache_.begin() + top, rowCache_.begin() + bottom + 1 - n, rowCache_.begin() + bottom + 1);
+    std::rotate(stale_.begin() + top, stale_.begin() + bottom + 1 - n, stale_.begin() + bottom + 1);
+    for (int r = top; r <= bottom; ++r) dirty_[(size_t)r] = 1;
+    for (int r = top; r < top + n; ++r) stale_[(size_t)r] = 1;
+}
+
+void VtScreen::eraseCells(int row, int from, int to) {
+    from = std::clamp(from, 0, cols_);
+    to = std::clamp(to, from, cols_);
+    if (from == to) return;
+    std::fill(&at(row, 0) + from, &at(row, 0) + to, blank());
+    markDirty(row);
+}
+
+void VtScreen::setMode(const int* params, size_t n, char prefix, bool on) {
+    for (size_t i = 0; i < n; ++i) {
+        int m = params[i];
+        if (prefix == 0) {
+            if (m == 4) insertMode_ = on;
+            continue;
+        }
+        if (prefix != '?') continue;
+        switch (m) {
+        case 1: appCursorKeys_ = on; break;
+        case 6: originMode_ = on; row_ = on ? top_ : 0; col_ = 0; break;
+        case 7: autoWrap_ = on; break;
+        case 25: cursorVisible_ = on; break;
+        case 47:
+        case 1047: setAlt(on, false); break;
+        case 1048: if (on) saveCursor(); else restoreCursor(); break;
+        case 1049: setAlt(on, true); break;
+        default: break;
+        }
+    }
+}
+
+// ---- Parser callbacks ----
+
+void VtScreen::print(std::string_view text) {
+    // A UTF-8 sequence split between two reads is completed by the next one
+    std::string joined;
+    if (!utf8Carry_.empty()) {
+        joined = utf8Carry_;
+        joined.append(text.data(), text.size());
+        utf8Carry_.clear();
+        text = joined;
+    }
+    size_t lead = text.size(), stop = lead > 4 ? lead - 4 : 0;
+    while (lead > stop && ((unsigned char)text[lead - 1] & 0xC0) == 0x80) --lead;
+    if (lead > 0 && (unsigned char)text[lead - 1] >= 0xC0 && lead - 1 + utf8_len((unsigned char)text[lead - 1]) > text.size()) {
+        utf8Carry_.assign(text.substr(lead - 1));
+        text = text.substr(0, lead - 1);
+    }
+    if (text.empty()) return;
+    if (!alt_) { printPrimary(text); return; }
+    for (size_t i = 0; i < text.size(); ) {
+        unsigned char c = (unsigned char)text[i];
+        putChar(c < 0x80 ? (char32_t)text[i++] : utf8_next(text, i));
+    }
+}
+
+void VtScreen::execute(char c) {
+    utf8Carry_.clear();
+    switch (c) {
+    case '\r':
+        if (alt_) col_ = 0; else col0_ = 0;
+        break;
+    case '\n': case '\v': case '\f':
+        if (alt_) { lineFeed(); break; }
+        // The primary screen is a list of lines: a new line always starts at column 0
+        pending_.append("\n", 1, TextStyle{});
+        lineCells_ = col0_ = 0;
+        break;
+    case '\b':
+        if (alt_) { if (col_ > 0) col_ = std::min(col_, cols_ - 1) - 1; }
+        else if (col0_ > 0) --col0_;
+        break;
+    case '\t':
+        if (alt_) col_ = std::min(cols_ - 1, (std::min(col_, cols_ - 1) / 8 + 1) * 8);
+        else col0_ = std::min((col0_ / 8 + 1) * 8, std::max(lineCells_, (size_t)cols_ - 1));
+        break;
+    default: // BEL and the rest are ignored
+        break;
+    }
+}
+
+void VtScreen::esc(char intermediate, char final) {
+    utf8Carry_.clear();
+    if (intermediate) return; // charset designations (ESC ( B, ...) and DECALN are not emulated
+    switch (final) {
+    case '7': saveCursor(); break;
+    case '8': restoreCursor(); break;
+    case 'c': reset(); break;
+    case 'D': execute('\n'); break; // IND
+    case 'E': execute('\r'); execute('\n'); break; // NEL
+    case 'M': // RI
+        if (!alt_) break;
+        if (row_ == top_) scrollDown(top_, bottom_, 1);
+        else if (row_ > 0) --row_;
+        break;
+    default: break; // keypad modes and the rest
+    }
+}
+
+void VtScreen::csi(const int* params, size_t n, char prefix, char intermediate, char final) {
+    utf8Carry_.clear();
+    if (intermediate) return; // DECSCUSR, DECSTR and friends
+    auto arg = [&](size_t i, int def) { return (i < n && params[i] > 0) ? params[i] : def; };
+    char buf[32];
+
+    if (prefix == '?' || prefix == '>' || prefix == '=' || prefix == '<') {
+        if (prefix == '?' && (final == 'h' || final == 'l')) setMode(params, n, prefix, final == 'h');
+        else if (prefix == '>' && final == 'c') replies_ += "\x1b[>0;10;1c";
+        return;
+    }
+
+    switch (final) {
+    case 'm': applySgr(pen_, params, n); return;
+    case 'h': case 'l': setMode(params, n, 0, final == 'h'); return;
+    case 'c': if (arg(0, 0) == 0) replies_ += "\x1b[?1;2c"; return;
+    case 'n':
+        if (arg(0, 0) == 5) replies_ += "\x1b[0n";
+        else if (arg(0, 0) == 6) {
+            int r = alt_ ? row_ + 1 - (originMode_ ? top_ : 0) : rows_;
+            int c = alt_ ? std::min(col_, cols_ - 1) + 1 : (int)std::min<size_t>(col0_, (size_t)cols_ - 1) + 1;
+            snprintf(buf, sizeof buf, "\x1b[%d;%dR", r, c);
+            replies_ += buf;
+        }
+        return;
+    case 's': saveCursor(); return;
+    case 'u': restoreCursor(); return;
+    case 'J':
+        if (arg(0, 0) >= 2) {
+            if (alt_) { for (int r = 0; r < rows_; ++r) eraseCells(r, 0, cols_); return; }
+            // Clearing the primary screen clears the scrollback (the tab's long-standing behavior)
+            pending_.text.clear();
+            pending_.runs.clear();
+            store_.clear();
+            recordSync();
+            lineCells_ = col0_ = 0;
+            cleared_ = true;
+            return;
+        }
+        break;
+    default: break;
+    }
+
+    if (!alt_) {
+        // Only horizontal motion and line edits make sense on a line-based screen
+        switch (final) {
+        case 'C': case 'a': col0_ += (size_t)arg(0, 1); break;
+        case 'D': col0_ -= std::min(col0_, (size_t)arg(0, 1)); break;
+        case 'G': case '`': col0_ = (size_t)arg(0, 1) - 1; break;
+        case 'H': case 'f': col0_ = (size_t)arg(1, 1) - 1; break;
+        case 'E': case 'F': col0_ = 0; break;
+        case 'J': // ED 0/1 within the only line we can address
+        case 'K':
+            if (arg(0, 0) == 0) { if (col0_ < lineCells_) spliceLine(col0_, lineCells_, {}); }
+            else if (arg(0, 0) == 1) {
+                size_t k = std::min(col0_ + 1, lineCells_);
+                spliceLine(0, k, std::string(k, ' '));
+            } else if (lineCells_ > 0) spliceLine(0, lineCells_, {});
+            break;
+        case 'X':
+            if (col0_ < lineCells_) {
+                size_t k = std::min((size_t)arg(0, 1), lineCells_ - col0_);
+                spliceLine(col0_, col0_ + k, std::string(k, ' '));
+            }
+            break;
+        case 'P': if (col0_ < lineCells_) spliceLine(col0_, col0_ + (size_t)arg(0, 1), {}); break;
+        case '@': if (col0_ < lineCells_) spliceLine(col0_, col0_, std::string((size_t)arg(0, 1), ' ')); break;
+        case 'r': top_ = 0; bottom_ = rows_ - 1; break;
+        default: break;
+        }
+        // Motion stays within the line or the window width, whichever is wider
+        col0_ = std::min(col0_, std::max(lineCells_, (size_t)cols_ - 1));
+        return;
+    }
+
+    const int lo = (row_ >= top_) ? top_ : 0;
+    const int hi = (row_ <= bottom_) ? bottom_ : rows_ - 1;
+    const int col = std::min(col_, cols_ - 1);
+    switch (final) {
+    case 'A': row_ = std::max(row_ - arg(0, 1), lo); col_ = col; break;
+    case 'B': case 'e': row_ = std::min(row_ + arg(0, 1), hi); col_ = col; break;
+    case 'C': case 'a': col_ = std::min(col + arg(0, 1), cols_ - 1); break;
+    case 'D': col_ = std::max(col - arg(0, 1), 0); break;
+    case 'E': row_ = std::min(row_ + arg(0, 1), hi); col_ = 0; break;
+    case 'F': row_ = std::max(row_ - arg(0, 1), lo); col_ = 0; break;
+    case 'G': case '`': col_ = std::min(arg(0, 1), cols_) - 1; break;
+    case 'd': {
+        int base = originMode_ ? top_ : 0;
+        row_ = std::min(base + arg(0, 1) - 1, originMode_ ? bottom_ : rows_ - 1);
+        col_ = col;
+        break;
+    }
+    case 'H': case 'f': {
+        int base = originMode_ ? top_ : 0;
+        row_ = std::min(base + arg(0, 1) - 1, originMode_ ? bottom_ : rows_ - 1);
+        col_ = std::min(arg(1, 1), cols_) - 1;
+        break;
+    }
+    case 'J':
+        if (arg(0, 0) == 0) {
+            eraseCells(row_, col, cols_);
+            for (int r = row_ + 1; r < rows_; ++r) eraseCells(r, 0, cols_);
+        } else {
+            for (int r = 0; r < row_; ++r) eraseCells(r, 0, cols_);
+            eraseCells(row_, 0, col + 1);
+        }
+        break;
+    case 'K':
+        if (arg(0, 0) == 0) eraseCells(row_, col, cols_);
+        else if (arg(0, 0) == 1) eraseCells(row_, 0, col + 1);
+        else eraseCells(row_, 0, cols_);
+        break;
+    case 'X': eraseCells(row_, col, col + arg(0, 1)); col_ = col; break;
+    case '@': {
+        int k = std::min(arg(0, 1), cols_ - col);
+        std::move_backward(&at(row_, col), &at(row_, 0) + (cols_ - k), &at(row_, 0) + cols_);
+        eraseCells(row_, col, col + k);
+        col_ = col;
+        break;
+    }
+    case 'P': {
+        int k = std::min(arg(0, 1), cols_ - col);
+        std::move(&at(row_, 0) + col + k, &at(row_, 0) + cols_, &at(row_, col));
+        eraseCells(row_, cols_ - k, cols_);
+        col_ = col;
+        break;
+    }
+    case 'L': if (row_ >= top_ && row_ <= bottom_) { scrollDown(row_, bottom_, arg(0, 1)); col_ = 0; } break;
+    case 'M': if (row_ >= top_ && row_ <= bottom_) { scrollUp(row_, bottom_, arg(0, 1)); col_ = 0; } break;
+    case 'S': scrollUp(top_, bottom_, arg(0, 1)); break;
+    case 'T': if (n <= 1) scrollDown(top_, bottom_, arg(0, 1)); break; // 5 params = mouse highlight
+    case 'r': {
+        int t = arg(0, 1) - 1, b = std::min(arg(1, rows_), rows_) - 1;
+        if (t < b) {
+            top_ = t;
+            bottom_ = b;
+            row_ = originMode_ ? top_ : 0;
+            col_ = 0;
+        }
+        break;
+    }
+    default: break;
+    }
+}
+
+} // namespace myterm
@@ -0,0 +1,259 @@
+#include "core/WatchLog.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace myterm {
+
+static const char kBinaryMagic[8] = {'M', 'W', 'L', 'O', 'G', '0', '0', '1'};
+
+static int64_t now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void put_le(std::string& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back((char)(v >> (8 * i)));
+}
+
+// `p` as the inside of a JSON string: controls escaped, valid UTF-8 as is, anything
+// else U+FFFD
+static void append_json(std::string& out, const char* p, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < n;) {
+        const unsigned char c = (unsigned char)p[i];
+        if (c < 0x80) {
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (c < 0x20 || c == 0x7f) { out += "\\u00"; out.push_back(hex[c >> 4]); out.push_back(hex[c & 15]); }
+                    else out.push_back((char)c);
+            }
+            ++i;
+            continue;
+        }
+        size_t len = c >= 0xc2 && c <= 0xdf ? 2 : c >= 0xe0 && c <= 0xef ? 3 : c >= 0xf0 && c <= 0xf4 ? 4 : 0;
+        bool ok = len > 0 && i + len <= n;
+        for (size_t k = 1; ok && k < len; ++k) ok = ((unsigned char)p[i + k] & 0xc0) == 0x80;
+        if (ok && len == 3) {
+            const unsigned char c1 = (unsigned char)p[i + 1];
+            ok = !(c == 0xe0 && c1 < 0xa0) && !(c == 0xed && c1 >= 0xa0); // overlong, surrogate
+        }
+        if (ok && len == 4) {
+            const unsigned char c1 = (unsigned char)p[i + 1];
+            ok = !(c == 0xf0 && c1 < 0x90) && !(c == 0xf4 && c1 >= 0x90); // overlong, past U+10FFFF
+        }
+        if (ok) { out.append(p + i, len); i += len; }
+        else { out += "\xef\xbf\xbd"; ++i; }
+    }
+}
+
+bool WatchLog::open(const std::string& path, Format format, std::string& error) {
+    close();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) { error = "multiWatch: " + path + ": " + strerror(errno); return false; }
+    kickFd_ = eventfd(0, EFD_CLOEXEC);
+    if (kickFd_ < 0) {
+        error = std::string("multiWatch: eventfd: ") + strerror(errno);
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    format_ = format;
+    stop_.store(false);
+    dropped_.store(0);
+    struct stat st;
+    if (format_ == Format::Binary && fstat(fd_, &st) == 0 && st.st_size == 0) batch_.assign(kBinaryMagic, sizeof kBinaryMagic);
+    // Signals stay with the watch loop, whose poll() they are meant to interrupt
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    thread_ = std::thread([this] { loop(); });
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    return true;
+}
+
+void WatchLog::close() {
+    if (fd_ < 0) return;
+    stop_.store(true);
+    uint64_t one = 1;
+    (void)!write(kickFd_, &one, sizeof one);
+    if (thread_.joinable()) thread_.join();
+    ::close(fd_);
+    ::close(kickFd_);
+    fd_ = kickFd_ = -1;
+}
+
+WatchLog::Event& WatchLog::next(uint8_t type, size_t cmd, uint64_t round) {
+    Event& e = scratch_;
+    e.type = type;
+    e.outcome = 0;
+    e.cmd = (uint32_t)cmd;
+    e.round = round;
+    e.monoNs = now_ns(CLOCK_MONOTONIC);
+    e.wallNs = now_ns(CLOCK_REALTIME);
+    e.value = 0;
+    e.status = 0;
+    e.data.clear();
+    return e;
+}
+
+void WatchLog::post() {
+    if (!queue_.push(scratch_)) { dropped_.fetch_add(1, std::memory_order_relaxed); return; }
+    // Pairs with the writer's fence between setting idle_ and looking at the queue
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_.load(std::memory_order_relaxed)) {
+        uint64_t one = 1;
+        (void)!write(kickFd_, &one, sizeof one);
+    }
+}
+
+void WatchLog::watch(const std::vector<std::string>& commands, long long intervalMs) {
+    if (fd_ < 0) return;
+    Event& e = next(Watch, 0, 0);
+    e.value = intervalMs;
+    for (auto& c : commands) { e.data += c; e.data.push_back('\0'); }
+    post();
+}
+
+void WatchLog::start(size_t cmd, uint64_t round, int64_t jitterNs) {
+    if (fd_ < 0) return;
+    next(Start, cmd, round).value = jitterNs;
+    post();
+}
+
+void WatchLog::output(size_t cmd, uint64_t round, const char* p, size_t n) {
+    if (fd_ < 0) return;
+    next(Output, cmd, round).data.assign(p, n);
+    post();
+}
+
+void WatchLog::end(size_t cmd, uint64_t round, Outcome outcome, int status, int64_t runtimeNs) {
+    if (fd_ < 0) return;
+    Event& e = next(End, cmd, round);
+    e.outcome = (uint8_t)outcome;
+    e.status = outcome == Outcome::Exit ? status : -1;
+    e.value = runtimeNs;
+    post();
+}
+
+void WatchLog::encode(const Event& e) {
+    std::string& out = batch_;
+    if (format_ == Format::Binary) {
+        put_le(out, e.type, 1);
+        put_le(out, e.outcome, 1);
+        put_le(out, 0, 2);
+        put_le(out, e.cmd, 4);
+        put_le(out, e.round, 8);
+        put_le(out, (uint64_t)e.monoNs, 8);
+        put_le(out, (uint64_t)e.wallNs, 8);
+        put_le(out, (uint64_t)e.value, 8);
+        put_le(out, (uint32_t)e.status, 4);
+        put_le(out, (uint32_t)e.data.size(), 4);
+        out += e.data;
+        return;
+    }
+    static const char* const kTypes[] = {"", "watch", "start", "output", "end", "dropped"};
+    static const char* const kOutcomes[] = {"exit", "timeout", "killed", "failed"};
+    out += "{\"type\":\"";
+    out += kTypes[e.type];
+    out += '"';
+    if (e.type == Start || e.type == Output || e.type == End) {
+        out += ",\"cmd\":" + std::to_string(e.cmd) + ",\"round\":" + std::to_string(e.round);
+    }
+    out += ",\"mono_ns\":" + std::to_string(e.monoNs) + ",\"wall_ns\":" + std::to_string(e.wallNs);
+    switch (e.type) {
+        case Watch: {
+            out += ",\"interval_ms\":" + std::to_string(e.value) + ",\"commands\":[";
+            size_t begin = 0;
+            for (size_t i = 0; i < e.data.size(); ++i) {
+                if (e.data[i] != '\0') continue;
+                if (begin) out += ',';
+                out += '"';
+                append_json(out, e.data.data() + begin, i - begin);
+                out += '"';
+                begin = i + 1;
+            }
+            out += ']';
+            break;
+        }
+        case Start:
+            out += ",\"jitter_ns\":" + std::to_string(e.value);
+            break;
+        case Output:
+            out += ",\"bytes\":" + std::to_string(e.data.size()) + ",\"data\":\"";
+            append_json(out, e.data.data(), e.data.size());
+            out += '"';
+            break;
+        case End:
+            out += ",\"outcome\":\"";
+            out += kOutcomes[e.outcome & 3];
+            out += "\",\"status\":" + std::to_string(e.status) + ",\"runtime_ns\":" + std::to_string(e.value);
+            break;
+        case Dropped:
+            out += ",\"records\":" + std::to_string(e.value);
+            break;
+    }
+    out += "}\n";
+}
+
+void WatchLog::flush() {
+    const char* p = batch_.data();
+    size_t n = batch_.size();
+    while (n > 0) {
+        ssize_t w = write(fd_, p, n);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break; // disk full or gone: what cannot be written is lost
+        p += w; n -= (size_t)w;
+    }
+    batch_.clear();
+}
+
+void WatchLog::loop() {
+    Event e;
+    for (;;) {
+        // Everything posted before close() is in the queue by the time stop_ reads true
+        const bool stopping = stop_.load();
+        bool got = false;
+        while (queue_.pop(e)) {
+            got = true;
+            encode(e);
+            if (batch_.size() >= kBatchBytes) flush();
+        }
+        if (uint64_t lost = dropped_.exchange(0)) {
+            Event d;
+            d.type = Dropped;
+            d.monoNs = now_ns(CLOCK_MONOTONIC);
+            d.wallNs = now_ns(CLOCK_REALTIME);
+            d.value = (int64_t)lost;
+            encode(d);
+        }
+        flush();
+        if (stopping) return;
+        if (got) continue;
+        idle_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (queue_.pop(e)) {
+            idle_.store(false, std::memory_order_relaxed);
+            encode(e);
+            continue;
+        }
+        if (!stop_.load()) {
+            uint64_t n;
+            while (read(kickFd_, &n, sizeof n) < 0 && errno == EINTR) {}
+        }
+        idle_.store(false, std::memory_order_relaxed);
+    }
+}
+
+} // namespace myterm
@@ -0,0 +1,159 @@
+#include "core/WatchPanes.hpp"
+#include <cstring>
+
+namespace myterm {
+
+// One line of output as plain text, appended to `out`: CSI/OSC sequences and other
+// controls dropped, tabs expanded
+static void append_plain(const char* s, size_t n, std::string& out) {
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '\t') { out.append(8 - out.size() % 8, ' '); continue; }
+        if (c == 0x1b && i + 1 < n) {
+            char k = s[i + 1];
+            if (k == '[') {
+                i += 2;
+                while (i < n && !((unsigned char)s[i] >= 0x40 && (unsigned char)s[i] <= 0x7e)) ++i;
+            } else if (k == ']') {
+                i += 2;
+                while (i < n && s[i] != '\a' && !(s[i] == 0x1b && i + 1 < n && s[i + 1] == '\\')) ++i;
+                if (i < n && s[i] == 0x1b) ++i;
+            } else {
+                ++i;
+            }
+            continue;
+        }
+        if (c < 0x20 || c == 0x7f) continue;
+        out.push_back((char)c);
+    }
+}
+
+void WatchPanes::reset(const std::vector<std::string>& commands, bool highlight) {
+    clear();
+    highlight_ = highlight;
+    panes_.resize(commands.size());
+    rounds_.resize(commands.size());
+    for (size_t i = 0; i < commands.size(); ++i) {
+        panes_[i].command = commands[i];
+        panes_[i].title = "\"" + commands[i] + "\"";
+    }
+}
+
+void WatchPanes::clear() {
+    panes_.clear();
+    rounds_.clear();
+    buf_.clear();
+    report_.clear();
+}
+
+bool WatchPanes::feed(const char* data, size_t n) {
+    bool changed = false;
+    buf_.append(data, n);
+    size_t off = 0;
+    while (buf_.size() - off >= kWatchRecordHeader) {
+        const char* p = buf_.data() + off;
+        uint32_t cmd, len;
+        memcpy(&cmd, p + 4, 4);
+        memcpy(&len, p + 8, 4);
+        if (buf_.size() - off - kWatchRecordHeader < len) break; // rest of it still to come
+        changed |= apply((WatchRecord)p[0], cmd, p + kWatchRecordHeader, len);
+        off += kWatchRecordHeader + len;
+    }
+    buf_.erase(0, off);
+    return changed;
+}
+
+// Output lines of the round in progress; `count` goes on past what the byte cap keeps
+void WatchPanes::addLines(Round& r, const char* p, size_t n, uint8_t changed) {
+    size_t i = 0;
+    while (i < n) {
+        const char* nl = (const char*)memchr(p + i, '\n', n - i);
+        const size_t e = nl ? (size_t)(nl - p) : n;
+        const bool stored = r.lines.size() == r.count;
+        if (!r.open) ++r.count;
+        r.bytes += e - i;
+        if (r.bytes > kMaxPaneBytes) {
+            r.truncated = true;
+        } else if (!r.open) {
+            r.lines.emplace_back();
+            r.changed.push_back(changed);
+            append_plain(p + i, e - i, r.lines.back());
+        } else if (stored) {
+            append_plain(p + i, e - i, r.lines.back());
+        }
+        r.open = !nl;
+        i = e + 1;
+    }
+}
+
+bool WatchPanes::apply(WatchRecord kind, uint32_t cmd, const char* p, size_t n) {
+    if (kind == WatchRecord::Report) { report_.assign(p, n); return false; }
+    if (cmd >= panes_.size()) return false;
+    Round& r = rounds_[cmd];
+    Pane& pane = panes_[cmd];
+    switch (kind) {
+        case WatchRecord::Begin:
+            r.title.assign(p, n);
+            r.lines.clear();
+            r.changed.clear();
+            r.count = r.bytes = 0;
+            r.open = r.truncated = false;
+            return false;
+        case WatchRecord::Data:
+            addLines(r, p, n, r.seen ? 1 : 0);
+            return false;
+        case WatchRecord::Stats:
+            r.stats.assign(p, n);
+            return false;
+        case WatchRecord::Report:
+            return false;
+        case WatchRecord::Keep: {
+            uint32_t keep = 0;
+            if (n == sizeof keep) memcpy(&keep, p, sizeof keep);
+            r.open = false;
+            for (uint32_t k = 0; k < keep; ++k, ++r.count) {
+                // The pane lost this line to the byte cap last round (or it never was)
+                if (r.count >= r.shown || r.truncated) { r.truncated = true; continue; }
+                const std::string& line = pane.lines[r.count];
+                r.bytes += line.size();
+                if (r.bytes > kMaxPaneBytes) { r.truncated = true; continue; }
+                r.lines.push_back(line);
+                r.changed.push_back(0);
+            }
+            return false;
+        }
+        case WatchRecord::End: {
+            r.open = false;
+            const size_t output = r.lines.size();
+            const size_t bytes = r.bytes;
+            r.bytes = 0; // the note is always shown
+            addLines(r, p, n, 0);
+            r.bytes = bytes;
+            if (!highlight_) r.changed.clear();
+            r.seen = true;
+            r.shown = output;
+            bool changed = false;
+            if (r.lines != pane.lines || r.changed != pane.changed || r.truncated != pane.truncated) {
+                pane.lines.swap(r.lines);
+                pane.changed.swap(r.changed);
+                pane.truncated = r.truncated;
+                ++pane.contentVersion;
+                changed = true;
+            }
+            if (r.title != pane.title) {
+                pane.title.swap(r.title);
+                ++pane.titleVersion;
+                changed = true;
+            }
+            if (r.stats != pane.stats) {
+                pane.stats = r.stats;
+                ++pane.statsVersion;
+                changed = true;
+            }
+            return changed;
+        }
+    }
+    return false;
+}
+
+} // namespace myterm
@@ -0,0 +1,63 @@
+#include "gui/BackBuffer.hpp"
+#include <algorithm>
+
+namespace myterm {
+
+bool BackBuffer::resize(Display* dpy, Window win, int w, int h, Font font) {
+    w = std::max(1, w);
+    h = std::max(1, h);
+    if (pixmap_ != None && w == w_ && h == h_) return false;
+    dpy_ = dpy;
+    const int scr = DefaultScreen(dpy);
+    Pixmap fresh = XCreatePixmap(dpy, win, (unsigned)w, (unsigned)h, (unsigned)DefaultDepth(dpy, scr));
+    if (!gc_) {
+        // A GC serves any drawable of the same depth, so it outlives the pixmaps
+        gc_ = XCreateGC(dpy, fresh, 0, nullptr);
+        if (font) XSetFont(dpy, gc_, font);
+        XSetGraphicsExposures(dpy, gc_, False); // copies inside the buffer need no expose events
+    }
+#ifdef USE_PANGO_CAIRO
+    if (!surface_) {
+        surface_ = cairo_xlib_surface_create(dpy, fresh, DefaultVisual(dpy, scr), w, h);
+        cr_ = cairo_create(surface_);
+    } else {
+        cairo_surface_flush(surface_);
+        cairo_xlib_surface_set_drawable(surface_, fresh, w, h);
+        cairo_reset_clip(cr_);
+    }
+#endif
+    if (pixmap_ != None) XFreePixmap(dpy, pixmap_);
+    pixmap_ = fresh;
+    w_ = w;
+    h_ = h;
+    return true;
+}
+
+void BackBuffer::release() {
+    if (!dpy_) return;
+#ifdef USE_PANGO_CAIRO
+    if (cr_) { cairo_destroy(cr_); cr_ = nullptr; }
+    if (surface_) { cairo_surface_destroy(surface_); surface_ = nullptr; }
+#endif
+    if (gc_) { XFreeGC(dpy_, gc_); gc_ = nullptr; }
+    if (pixmap_ != None) { XFreePixmap(dpy_, pixmap_); pixmap_ = None; }
+    w_ = h_ = 0;
+}
+
+void BackBuffer::present(Window win, GC gc, int x, int y, int w, int h) {
+    if (pixmap_ == None) return;
+    if (w < 0) w = w_;
+    if (h < 0) h = h_;
+    // Clip to the buffer
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    w = std::min(w, w_ - x);
+    h = std::min(h, h_ - y);
+    if (w <= 0 || h <= 0) return;
+#ifdef USE_PANGO_CAIRO
+    cairo_surface_flush(surface_); // hand any batched cairo drawing to the server first
+#endif
+    XCopyArea(dpy_, pixmap_, win, gc, x, y, (unsigned)w, (unsigned)h, x, y);
+}
+
+} // namespace myterm
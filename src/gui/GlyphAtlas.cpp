@@ -0,0 +1,82 @@
+#include "gui/GlyphAtlas.hpp"
+#ifdef USE_PANGO_CAIRO
+#include <algorithm>
+
+namespace myterm {
+
+void GlyphAtlas::configure(int cellW, int ascent, int descent) {
+    if (cellW == cellW_ && ascent == ascent_ && descent == descent_) return;
+    clear();
+    cellW_ = cellW;
+    ascent_ = ascent;
+    descent_ = descent;
+}
+
+void GlyphAtlas::setBudget(size_t bytes) {
+    budget_ = bytes;
+    evict();
+}
+
+void GlyphAtlas::clear() {
+    for (Entry& e : lru_) if (e.mask) cairo_surface_destroy(e.mask);
+    lru_.clear();
+    map_.clear();
+    bytes_ = 0;
+}
+
+void GlyphAtlas::evict() {
+    // Keep the newest entry even if it alone is over budget
+    while (bytes_ > budget_ && lru_.size() > 1) {
+        Entry& e = lru_.back();
+        bytes_ -= e.bytes;
+        if (e.mask) cairo_surface_destroy(e.mask);
+        map_.erase(e.key);
+        lru_.pop_back();
+    }
+}
+
+cairo_surface_t* GlyphAtlas::lookup(PangoLayout* layout, const PangoFontDescription* font, std::string_view cluster, uint8_t style) {
+    probe_.assign(1, (char)style);
+    probe_.append(cluster.data(), cluster.size());
+    auto it = map_.find(probe_);
+    if (it != map_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->mask;
+    }
+
+    cairo_surface_t* mask = nullptr;
+    size_t bytes = probe_.size() + sizeof(Entry) + 64; // key, node and map overhead
+    bool blank = std::all_of(cluster.begin(), cluster.end(), [](char c) { return c == ' '; });
+    if (!blank && cellW_ > 0) {
+        PangoFontDescription* styled = nullptr;
+        if (style) {
+            styled = pango_font_description_copy(font);
+            if (style & kBold) pango_font_description_set_weight(styled, PANGO_WEIGHT_BOLD);
+            if (style & kItalic) pango_font_description_set_style(styled, PANGO_STYLE_ITALIC);
+        }
+        pango_layout_set_font_description(layout, styled ? styled : font);
+        pango_layout_set_text(layout, cluster.data(), (int)cluster.size());
+        PangoRectangle logical; pango_layout_get_pixel_extents(layout, nullptr, &logical);
+        // Centered in the cell, one pixel of headroom and room below for descenders
+        const int h = ascent_ + descent_ + 4;
+        mask = cairo_image_surface_create(CAIRO_FORMAT_A8, cellW_, h);
+        cairo_t* cr = cairo_create(mask);
+        cairo_move_to(cr, std::max(0, (cellW_ - logical.width) / 2), 1);
+        pango_cairo_show_layout(cr, layout);
+        cairo_destroy(cr);
+        cairo_surface_flush(mask);
+        bytes += (size_t)cairo_image_surface_get_stride(mask) * (size_t)h;
+        if (styled) {
+            pango_layout_set_font_description(layout, font);
+            pango_font_description_free(styled);
+        }
+    }
+    lru_.push_front(Entry{probe_, mask, bytes});
+    map_.emplace(probe_, lru_.begin());
+    bytes_ += bytes;
+    evict();
+    return mask;
+}
+
+} // namespace myterm
+#endif
@@ -4,13 +4,14 @@ namespace myterm {
 
 // Revert: remove explicit constructor and rely on default member initializers in Tab.hpp
 
-void Tab::appendOutput(const std::string& s, size_t cap) {
-    if (scrollback.size() + s.size() > cap) {
-        size_t drop = scrollback.size() + s.size() - cap;
-        if (drop >= scrollback.size()) scrollback.clear(); else scrollback.erase(0, drop);
-    }
-    scrollback += s;
+void Tab::appendOutput(std::string_view s) {
+    scrollback.append(s); // evicts oldest lines past the tab's limits
     scrollToBottom = true; // always auto-scroll on new output (original behavior)
 }
 
+void Tab::appendOutput(const StyledText& s) {
+    scrollback.append(s);
+    scrollToBottom = true;
+}
+
 } // namespace myterm
@@ -10,17 +10,20 @@
 #include <locale.h>
 #include <unistd.h>
 #include <pwd.h>
-#include <sys/select.h>
+#include <sys/ioctl.h>
 #include <sys/time.h>
 #include <limits.h>
 #include <time.h>
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <dirent.h>
 #include <memory>
 #include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <cerrno>
 #include <fcntl.h>
@@ -34,7 +37,6 @@ namespace myterm {
 // UTF-8 helpers for proper Unicode handling
 static inline bool utf8_is_cont(unsigned char b) { return (b & 0xC0) == 0x80; }
 
-#ifndef USE_PANGO_CAIRO
 [[maybe_unused]] static size_t utf8_char_len_from_lead(unsigned char b) {
     if (b < 0x80) return 1;
     if ((b & 0xE0) == 0xC0) {
@@ -48,10 +50,8 @@ static inline bool utf8_is_cont(unsigned char b) { return (b & 0xC0) == 0x80; }
     }
     return 1; // invalid
 }
-#endif
 
-#ifndef USE_PANGO_CAIRO
-static size_t utf8_next_len(const std::string& s, size_t off) {
+[[maybe_unused]] static size_t utf8_next_len(std::string_view s, size_t off) {
     if (off >= s.size()) return 0;
     unsigned char lead = (unsigned char)s[off];
     size_t len = utf8_char_len_from_lead(lead);
@@ -62,10 +62,9 @@ static size_t utf8_next_len(const std::string& s, size_t off) {
     }
     return len;
 }
-#endif
 
 // Replace invalid UTF-8 sequences with U+FFFD
-static std::string sanitize_to_valid_utf8(const std::string& s) {
+static std::string sanitize_to_valid_utf8(std::string_view s) {
     std::string out; out.reserve(s.size());
     size_t off = 0;
     const char rep[3] = {(char)0xEF, (char)0xBF, (char)0xBD}; // U+FFFD
@@ -123,7 +122,7 @@ static std::string sanitize_to_valid_utf8(const std::string& s) {
 
 // --- Grapheme cluster helpers using Pango/GLib (for accurate Unicode shaping) ---
 #ifdef USE_PANGO_CAIRO
-static std::vector<size_t> utf8_grapheme_boundaries_bytes(PangoLayout* layout, const std::string& s) {
+static std::vector<size_t> utf8_grapheme_boundaries_bytes(PangoLayout* layout, std::string_view s) {
     std::vector<size_t> bounds;
     if (!layout) return bounds;
     std::string safe = sanitize_to_valid_utf8(s);
@@ -151,13 +150,13 @@ static std::vector<size_t> utf8_grapheme_boundaries_bytes(PangoLayout* layout, c
     return bounds;
 }
 
-static size_t utf8_grapheme_count(PangoLayout* layout, const std::string& s) {
+static size_t utf8_grapheme_count(PangoLayout* layout, std::string_view s) {
     auto b = utf8_grapheme_boundaries_bytes(layout, s);
     if (b.empty()) return 0;
     return b.size() - 1;
 }
 
-static size_t utf8_grapheme_index_upto(PangoLayout* layout, const std::string& s, size_t byte_off) {
+static size_t utf8_grapheme_index_upto(PangoLayout* layout, std::string_view s, size_t byte_off) {
     auto b = utf8_grapheme_boundaries_bytes(layout, s);
     if (b.empty()) return 0;
     std::string safe = sanitize_to_valid_utf8(s);
@@ -168,7 +167,7 @@ static size_t utf8_grapheme_index_upto(PangoLayout* layout, const std::string& s
     return idx; // number of clusters fully before or at offset
 }
 
-static std::string utf8_substr_grapheme(PangoLayout* layout, const std::string& s, size_t start_g, size_t len_g) {
+static std::string utf8_substr_grapheme(PangoLayout* layout, std::string_view s, size_t start_g, size_t len_g) {
     auto b = utf8_grapheme_boundaries_bytes(layout, s);
     if (b.empty()) return std::string();
     size_t total = b.size() - 1;
@@ -187,11 +186,11 @@ static std::string utf8_substr_grapheme(PangoLayout* layout, const std::string&
 // Provide non-Pango fallbacks so IntelliSense (or non-Pango builds) see valid symbols
 #ifndef USE_PANGO_CAIRO
 // Forward declarations for fallback helpers used below
-static size_t utf8_count_codepoints(const std::string& s);
-static size_t utf8_count_codepoints_upto(const std::string& s, size_t byte_off);
-static std::string utf8_substr_cp(const std::string& s, size_t start_cp, size_t len_cp);
+static size_t utf8_count_codepoints(std::string_view s);
+static size_t utf8_count_codepoints_upto(std::string_view s, size_t byte_off);
+static std::string utf8_substr_cp(std::string_view s, size_t start_cp, size_t len_cp);
 
-static std::vector<size_t> utf8_grapheme_boundaries_bytes(void*, const std::string& s) {
+static std::vector<size_t> utf8_grapheme_boundaries_bytes(void*, std::string_view s) {
     // Treat each Unicode code point as a grapheme cluster
     std::vector<size_t> bounds; bounds.reserve(s.size()+1);
     bounds.push_back(0);
@@ -205,13 +204,13 @@ static std::vector<size_t> utf8_grapheme_boundaries_bytes(void*, const std::stri
     if (bounds.back() != s.size()) bounds.push_back(s.size());
     return bounds;
 }
-static size_t utf8_grapheme_count(void*, const std::string& s) {
+static size_t utf8_grapheme_count(void*, std::string_view s) {
     return utf8_count_codepoints(s);
 }
-static size_t utf8_grapheme_index_upto(void*, const std::string& s, size_t byte_off) {
+static size_t utf8_grapheme_index_upto(void*, std::string_view s, size_t byte_off) {
     return utf8_count_codepoints_upto(s, byte_off);
 }
-static std::string utf8_substr_grapheme(void*, const std::string& s, size_t start_g, size_t len_g) {
+static std::string utf8_substr_grapheme(void*, std::string_view s, size_t start_g, size_t len_g) {
     return utf8_substr_cp(s, start_g, len_g);
 }
 #endif
@@ -225,7 +224,7 @@ static std::string utf8_substr_grapheme(void*, const std::string& s, size_t star
 
 #ifndef USE_PANGO_CAIRO
 // Count Unicode code points in a UTF-8 string (non-Pango fallback build only)
-static size_t utf8_count_codepoints(const std::string& s) {
+static size_t utf8_count_codepoints(std::string_view s) {
     size_t count = 0;
     size_t i = 0;
     while (i < s.size()) {
@@ -239,7 +238,7 @@ static size_t utf8_count_codepoints(const std::string& s) {
 }
 
 // Count code points from start up to a given byte offset (clamped)
-static size_t utf8_count_codepoints_upto(const std::string& s, size_t byte_off) {
+static size_t utf8_count_codepoints_upto(std::string_view s, size_t byte_off) {
     if (byte_off > s.size()) byte_off = s.size();
     size_t count = 0;
     size_t i = 0;
@@ -254,7 +253,7 @@ static size_t utf8_count_codepoints_upto(const std::string& s, size_t byte_off)
 }
 
 // Compute the byte offset at which a given code point index starts
-static size_t utf8_byte_offset_for_codepoints(const std::string& s, size_t cp_index) {
+static size_t utf8_byte_offset_for_codepoints(std::string_view s, size_t cp_index) {
     size_t i = 0;
     size_t cp = 0;
     while (i < s.size() && cp < cp_index) {
@@ -267,13 +266,13 @@ static size_t utf8_byte_offset_for_codepoints(const std::string& s, size_t cp_in
 }
 
 // Take a substring by code point count (start_cp, len_cp)
-static std::string utf8_substr_cp(const std::string& s, size_t start_cp, size_t len_cp) {
+static std::string utf8_substr_cp(std::string_view s, size_t start_cp, size_t len_cp) {
     size_t start_b = utf8_byte_offset_for_codepoints(s, start_cp);
     size_t end_b = utf8_byte_offset_for_codepoints(s, start_cp + len_cp);
     if (start_b > s.size()) start_b = s.size();
     if (end_b > s.size()) end_b = s.size();
     if (end_b < start_b) end_b = start_b;
-    return s.substr(start_b, end_b - start_b);
+    return std::string(s.substr(start_b, end_b - start_b));
 }
 #endif // !USE_PANGO_CAIRO
 
@@ -348,15 +347,28 @@ static std::string get_cwd() {
     return "?";
 }
 
+// A size from the environment; `fallback` when unset or not a number
+static size_t env_size(const char* name, size_t fallback) {
+    const char* v = getenv(name);
+    if (!v || !*v) return fallback;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long n = strtoull(v, &end, 10);
+    return (*end || errno || v[0] == '-') ? fallback : (size_t)n;
+}
+
 TerminalWindow::TerminalWindow(int w, int h): width_(w), height_(h) {
     setlocale(LC_ALL, "");
-    tabs_.emplace_back(std::make_unique<Tab>());
+    scrollbackLines_ = env_size("MYTERM_SCROLLBACK_LINES", ScrollbackStore::kDefaultMaxLines);
+    scrollbackBytes_ = env_size("MYTERM_SCROLLBACK_BYTES", ScrollbackStore::kDefaultMaxBytes);
+    tabs_.emplace_back(std::make_unique<Tab>(scrollbackLines_, scrollbackBytes_));
 }
 
 TerminalWindow::~TerminalWindow() {
 #ifdef USE_PANGO_CAIRO
     destroyCairoObjects();
 #endif
+    back_.release();
     if (xic_) XDestroyIC(xic_);
     if (xim_) XCloseIM(xim_);
     if (font_) XFreeFont(dpy_, font_);
@@ -448,6 +460,7 @@ void TerminalWindow::allocateColors() {
     alloc("#6a6a6a", theme_.scrollThumbHover);
     alloc("#3a3a3a", theme_.tabHoverBg);
     alloc("#2a2a2a", theme_.newTabBg);
+    alloc("#4a4528", theme_.changedBg);
 
     // ANSI 16 colors
     const char* ansiColors[16] = {
@@ -460,11 +473,16 @@ void TerminalWindow::allocateColors() {
         alloc(ansiColors[i], theme_.ansiFgColors[i]);
         theme_.ansiBgColors[i] = theme_.ansiFgColors[i];
     }
+    // Rest of the xterm 256-color palette, allocated once so styled text never round-trips per draw
+    std::vector<unsigned long> ext;
+    for (int i=16; i<256; i++) ext.push_back(ansiColorToPixel(i, true));
+    theme_.ansiFgColors.insert(theme_.ansiFgColors.end(), ext.begin(), ext.end());
+    theme_.ansiBgColors.insert(theme_.ansiBgColors.end(), ext.begin(), ext.end());
     // Xft not used
 }
 
 unsigned long TerminalWindow::ansiColorToPixel(int code, bool fg) const {
-    if (code >= 0 && code < 16) {
+    if (code >= 0 && code < (int)theme_.ansiFgColors.size()) {
         return fg ? theme_.ansiFgColors[code] : theme_.ansiBgColors[code];
     } else if (code >= 16 && code < 232) {
         // 6x6x6 cube
@@ -552,12 +570,8 @@ int TerminalWindow::measureTextPango(const std::string& utf8) {
     return clusters * charWidth();
 }
 void TerminalWindow::ensureCairoSurface() {
-    if (!cairoSurface_ || cairoW_ != width_ || cairoH_ != height_) {
-        if (cairoSurface_) cairo_surface_destroy(cairoSurface_);
-        cairoSurface_ = cairo_xlib_surface_create(dpy_, win_, DefaultVisual(dpy_, screen_), width_, height_);
-        cairoW_ = width_; cairoH_ = height_;
-    }
-    if (!cr_) cr_ = cairo_create(cairoSurface_);
+    if (!back_.valid()) ensureBackBuffer();
+    cr_ = back_.cairo();
     if (!pangoLayout_) pangoLayout_ = pango_cairo_create_layout(cr_);
     if (!pangoFontDesc_) {
         pangoFontDesc_ = pango_font_description_new();
@@ -584,90 +598,109 @@ void TerminalWindow::ensureCairoSurface() {
         cairo_font_options_set_hint_metrics(font_options, CAIRO_HINT_METRICS_ON);
         pango_cairo_context_set_font_options(pango_layout_get_context(pangoLayout_), font_options);
         cairo_font_options_destroy(font_options);
+
+        // After creating layout and font description, compute metrics and cell width once
+        PangoContext* ctx = pango_layout_get_context(pangoLayout_);
+        PangoFontMetrics* m = pango_context_get_metrics(ctx, pangoFontDesc_, pango_language_get_default());
+        pangoAscent_ = pango_font_metrics_get_ascent(m) / PANGO_SCALE;
+        pangoDescent_ = pango_font_metrics_get_descent(m) / PANGO_SCALE;
+        pango_font_metrics_unref(m);
+        cellW_ = compute_pango_cell_width(pangoLayout_, pangoFontDesc_);
+        // Slightly tighten horizontal spacing for Unicode clusters
+        if (cellW_ > 1) cellW_ -= 1;
+        // Align overall line height to Pango metrics with minimal extra padding to avoid clipping
+        int pangoLine = pangoAscent_ + pangoDescent_;
+        lineH_ = std::max(lineH_, pangoLine + 4);
+        glyphs_.configure(cellW_, pangoAscent_, pangoDescent_);
     }
-    // After creating layout and font description, compute metrics and cell width once
-    PangoContext* ctx = pango_layout_get_context(pangoLayout_);
-    PangoFontMetrics* m = pango_context_get_metrics(ctx, pangoFontDesc_, pango_language_get_default());
-    pangoAscent_ = pango_font_metrics_get_ascent(m) / PANGO_SCALE;
-    pangoDescent_ = pango_font_metrics_get_descent(m) / PANGO_SCALE;
-    pango_font_metrics_unref(m);
-    cellW_ = compute_pango_cell_width(pangoLayout_, pangoFontDesc_);
-    // Slightly tighten horizontal spacing for Unicode clusters
-    if (cellW_ > 1) cellW_ -= 1;
-    // Align overall line height to Pango metrics with minimal extra padding to avoid clipping
-    int pangoLine = pangoAscent_ + pangoDescent_;
-    lineH_ = std::max(lineH_, pangoLine + 4);
 }
 
-void TerminalWindow::drawTextPango(int x, int y, const std::string& utf8, unsigned long fgPixel) {
-    ensureCairoSurface();
-    // Convert X11 pixel to RGB components (approximate)
-    XColor c; c.pixel = fgPixel; XQueryColor(dpy_, cmap_, &c);
-    double r = c.red / 65535.0, g = c.green / 65535.0, b = c.blue / 65535.0;
-    cairo_set_source_rgb(cr_, r, g, b);
+void TerminalWindow::setSourcePixel(unsigned long pixel, double alpha) {
+    uint32_t rgb = 0;
+    auto it = std::find_if(pixelRgb_.begin(), pixelRgb_.end(), [&](const auto& e) { return e.first == pixel; });
+    if (it != pixelRgb_.end()) {
+        rgb = it->second;
+    } else {
+        // Convert X11 pixel to RGB components (approximate)
+        XColor c; c.pixel = pixel; XQueryColor(dpy_, cmap_, &c);
+        rgb = (uint32_t)(c.red >> 8) << 16 | (uint32_t)(c.green >> 8) << 8 | (uint32_t)(c.blue >> 8);
+        pixelRgb_.emplace_back(pixel, rgb);
+    }
+    cairo_set_source_rgba(cr_, (rgb >> 16) / 255.0, (rgb >> 8 & 0xFF) / 255.0, (rgb & 0xFF) / 255.0, alpha);
+}
 
-    std::string safeUtf8 = sanitize_to_valid_utf8(utf8);
+// Blit each grapheme cluster of `safeUtf8` from the glyph atlas, one cell apiece, in the
+// current source color. Clusters are rasterized on first use only.
+int TerminalWindow::drawClusters(int x, int y, const std::string& safeUtf8, uint8_t style) {
+    const int char_width = charWidth();
+    // Use global ascent/descent for consistent baseline; masks carry one pixel of headroom
+    const double top_y = y - pangoAscent_ - 1;
+    int clusters = 0;
+    auto blit = [&](const char* p, size_t n) {
+        if (cairo_surface_t* mask = glyphs_.lookup(pangoLayout_, pangoFontDesc_, std::string_view(p, n), style))
+            cairo_mask_surface(cr_, mask, x + clusters * char_width, top_y);
+        ++clusters;
+    };
+    if (std::all_of(safeUtf8.begin(), safeUtf8.end(), [](char ch) { return (unsigned char)ch < 0x80; })) {
+        // ASCII: every byte is its own cluster, no need to ask Pango
+        for (size_t i = 0; i < safeUtf8.size(); ++i) blit(safeUtf8.data() + i, 1);
+        return clusters;
+    }
 
-    // Render by grapheme clusters so complex scripts (e.g., Devanagari) shape correctly
+    // Split by grapheme clusters so complex scripts (e.g., Devanagari) shape correctly
     pango_layout_set_text(pangoLayout_, safeUtf8.c_str(), (int)safeUtf8.size());
     pango_layout_set_font_description(pangoLayout_, pangoFontDesc_);
-
     PangoLogAttr* attrs = nullptr; int n_attrs = 0;
     pango_layout_get_log_attrs(pangoLayout_, &attrs, &n_attrs);
     int n_chars = (int)g_utf8_strlen(safeUtf8.c_str(), (gssize)safeUtf8.size());
     if (!attrs || n_attrs == 0) {
-        // Fallback: draw as single run
-        int char_width = charWidth();
-        PangoRectangle logical; pango_layout_get_pixel_extents(pangoLayout_, nullptr, &logical);
-        int offset_x = std::max(0, (char_width - logical.width) / 2);
-        // Use global ascent/descent for consistent baseline and to avoid clipping descenders
-        int top_y = y - pangoAscent_;
-        cairo_save(cr_);
-        cairo_rectangle(cr_, x, top_y - 1, char_width, pangoAscent_ + pangoDescent_ + 4);
-        cairo_clip(cr_);
-        cairo_move_to(cr_, x + offset_x, top_y);
-        pango_cairo_show_layout(cr_, pangoLayout_);
-        cairo_restore(cr_);
-        return;
+        // Fallback: draw as single cluster
+        blit(safeUtf8.data(), safeUtf8.size());
+        return clusters;
     }
-
-    int current_x = x;
-    int char_width = charWidth();
-    int start_char = 0;
+    const char* start_ptr = safeUtf8.c_str();
     for (int pos = 1; pos <= n_chars; ++pos) {
         if (!attrs[pos].is_cursor_position) continue; // not a grapheme boundary
-        // Map char indices to byte offsets
-        const char* start_ptr = g_utf8_offset_to_pointer(safeUtf8.c_str(), start_char);
-        const char* end_ptr   = g_utf8_offset_to_pointer(safeUtf8.c_str(), pos);
-        std::string cluster(start_ptr, end_ptr - start_ptr);
-
-        pango_layout_set_text(pangoLayout_, cluster.c_str(), (int)cluster.size());
-        PangoRectangle logical; pango_layout_get_pixel_extents(pangoLayout_, nullptr, &logical);
-        int offset_x = std::max(0, (char_width - logical.width) / 2);
-    // Use global ascent/descent for consistent baseline and avoid per-glyph baseline jitter
-    int top_y = y - pangoAscent_; // baseline at y
-        cairo_save(cr_);
-    // Minimal vertical padding to ensure underscores/descenders are not clipped
-    cairo_rectangle(cr_, current_x, top_y - 1, char_width, pangoAscent_ + pangoDescent_ + 4);
-        cairo_clip(cr_);
-        cairo_move_to(cr_, current_x + offset_x, top_y);
-        pango_cairo_show_layout(cr_, pangoLayout_);
-        cairo_restore(cr_);
-        current_x += char_width;
-        start_char = pos;
+        const char* end_ptr = g_utf8_offset_to_pointer(safeUtf8.c_str(), pos);
+        blit(start_ptr, (size_t)(end_ptr - start_ptr));
+        start_ptr = end_ptr;
     }
-    if (attrs) g_free(attrs);
+    g_free(attrs);
+    return clusters;
+}
+
+void TerminalWindow::drawTextPango(int x, int y, const std::string& utf8, unsigned long fgPixel) {
+    ensureCairoSurface();
+    setSourcePixel(fgPixel);
+    drawClusters(x, y, sanitize_to_valid_utf8(utf8), 0);
 }
 
 void TerminalWindow::destroyCairoObjects() {
     if (pangoLayout_) { g_object_unref(pangoLayout_); pangoLayout_ = nullptr; }
     if (pangoFontDesc_) { pango_font_description_free(pangoFontDesc_); pangoFontDesc_ = nullptr; }
-    if (cr_) { cairo_destroy(cr_); cr_ = nullptr; }
-    if (cairoSurface_) { cairo_surface_destroy(cairoSurface_); cairoSurface_ = nullptr; }
+    glyphs_.clear();
+    cr_ = nullptr; // owned by back_
 }
 #endif
 
+// FNV-1a, used for the content keys of the damage tracker (tab bar, rows, scrollbar)
+static constexpr uint64_t kFnvBasis = 1469598103934665603ull;
+static uint64_t fnv1a_bytes(uint64_t h, const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) { h ^= (unsigned char)p[i]; h *= 1099511628211ull; }
+    return h;
+}
+static uint64_t fnv1a_mix(uint64_t h, uint64_t v) {
+    return fnv1a_bytes(h, reinterpret_cast<const char*>(&v), sizeof v);
+}
+
 void TerminalWindow::drawTabBar() {
+    uint64_t key = fnv1a_mix(fnv1a_mix(fnv1a_mix(kFnvBasis, tabs_.size()), (uint64_t)activeTab_),
+                             ((uint64_t)(uint32_t)hoverTabIndex_ << 1) | (hoverNewTab_ ? 1 : 0));
+    if (key == tabBarKey_) return;
+    tabBarKey_ = key;
+    XSetForeground(dpy_, gc_, theme_.bg);
+    XFillRectangle(dpy_, win_, gc_, 0, 0, width_, 40);
+    addDamage(0, 40);
     int tabH = 26;
     int tabW = 140;
     int tabSpacing = 4;
@@ -730,30 +763,58 @@ void TerminalWindow::drawTabBar() {
 #endif
 }
 
+int TerminalWindow::wrapColumns() const {
+    return std::max(1, (width_ - 20) / charWidth());
+}
+
+int TerminalWindow::viewportRows() const {
+    return std::max(1, (height_ - 40 - lineH_) / lineH_);
+}
+
+void TerminalWindow::resizeTerminal(Tab& t) {
+    t.vt.resize(wrapColumns(), viewportRows());
+    // A PTY job learns the new size (and gets SIGWINCH) through its master side
+    if (t.childPid > 0 && t.outFd >= 0 && t.inFdWrite == t.outFd) {
+        struct winsize ws{};
+        ws.ws_row = (unsigned short)t.vt.rows();
+        ws.ws_col = (unsigned short)t.vt.cols();
+        ioctl(t.outFd, TIOCSWINSZ, &ws);
+    }
+}
+
+// Grapheme boundaries of a scrollback line, as byte offsets into the raw (unsanitized) text
+void TerminalWindow::segmentLine(std::string_view line, std::vector<uint32_t>& bounds) {
+#ifdef USE_PANGO_CAIRO
+    if (sanitize_to_valid_utf8(line).size() == line.size()) {
+        for (size_t b : utf8_grapheme_boundaries_bytes(MYTERM_LAYOUT, line)) bounds.push_back((uint32_t)b);
+        return;
+    }
+    // Invalid bytes: Pango would see U+FFFD instead, so fall back to code points of the raw text
+    bounds.push_back(0);
+    for (size_t i = 0, len; i < line.size() && (len = utf8_next_len(line, i)) > 0; ) { i += len; bounds.push_back((uint32_t)i); }
+#else
+    for (size_t b : utf8_grapheme_boundaries_bytes(nullptr, line)) bounds.push_back((uint32_t)b);
+#endif
+}
+
 void TerminalWindow::drawTextArea() {
     #ifdef USE_PANGO_CAIRO
     ensureCairoSurface();
     #endif
-    int y = 40 + lineH_; // below tab bar
     Tab& t = *tabs_[activeTab_];
 
-    // Build lines from scrollback plus live prompt+input (which may be multi-line)
-    size_t start=0; std::vector<std::string> lines;
-    for (size_t i=0;i<t.scrollback.size();++i) if (t.scrollback[i]=='\n') { lines.emplace_back(t.scrollback.substr(start,i-start)); start=i+1; }
-    if (start<t.scrollback.size()) lines.emplace_back(t.scrollback.substr(start));
-
-    // Soft-wrap scrollback lines
-    std::vector<std::string> wrappedLines;
-    int wrapCols = std::max(1, (width_ - 20) / charWidth());
-    for (const std::string& line : lines) {
-        int graphemeCount = (int)utf8_grapheme_count(MYTERM_LAYOUT, line);
-        for (int s = 0; s < graphemeCount; s += wrapCols) {
-            int len = std::min(wrapCols, graphemeCount - s);
-            std::string sub = utf8_substr_grapheme(MYTERM_LAYOUT, line, (size_t)s, (size_t)len);
-            wrappedLines.push_back(sub);
-        }
-    }
-    lines = std::move(wrappedLines);
+    // Rows are numbered scrollback first, then live prompt+input (which may be multi-line).
+    // Scrollback rows are only counted here, via the tab's wrap cache (each line is segmented
+    // once); the few that end up on screen are fetched in the draw loop below.
+    // Viewport height: reserve only the top margin (lineH_) below the tab bar, no extra bottom padding
+    if (t.watchActive) { drawWatchPanes(t); return; }
+    if (t.vt.altActive()) { drawAltScreen(t); return; }
+    int viewportLines = viewportRows();
+    t.wrap.setColumns(wrapColumns());
+    t.wrap.sync(t.scrollback, [this](std::string_view line, std::vector<uint32_t>& bounds) { segmentLine(line, bounds); });
+    t.wrap.reflowVisible((size_t)std::max(0, t.scrollOffsetTargetLines) + (size_t)viewportLines);
+    const int sbRows = (int)t.wrap.totalRows();
+    std::vector<std::string> lines; // live rows, numbered from sbRows
 
     // Only honor auto-scroll to bottom if we're already at the bottom; if user scrolled up, don't snap
     if (t.scrollToBottom && t.scrollOffsetLines == 0) { t.scrollOffsetTargetLines = 0; t.scrollToBottom = false; }
@@ -764,7 +825,7 @@ void TerminalWindow::drawTextArea() {
         size_t s=0,p=0; while ((p = t.input.find('\n', s)) != std::string::npos) { inputParts.emplace_back(t.input.substr(s, p-s)); s=p+1; }
         inputParts.emplace_back(t.input.substr(s));
     }
-    int firstLiveIdx = (int)lines.size();
+    int firstLiveIdx = sbRows;
     bool searchActive = (searchActive_ && t.childPid <= 0);
     int searchLineIdx = -1;
     // Build live input lines and map caret in one consistent pass (handles wrap and newlines)
@@ -848,7 +909,7 @@ void TerminalWindow::drawTextArea() {
     if (searchActive) {
         std::string prompt = "Enter search term: ";
         lines.emplace_back(prompt + searchTerm_);
-        searchLineIdx = (int)lines.size() - 1;
+        searchLineIdx = sbRows + (int)lines.size() - 1;
         // Place caret at end of search term
         if (t.childPid <= 0) {
             cursorColForLive = (int)utf8_grapheme_count(MYTERM_LAYOUT, prompt) + (int)utf8_grapheme_count(MYTERM_LAYOUT, searchTerm_);
@@ -856,24 +917,23 @@ void TerminalWindow::drawTextArea() {
         }
     }
 
+    const int totalRows = sbRows + (int)lines.size();
 
-    // Viewport height: reserve only the top margin (lineH_) below the tab bar, no extra bottom padding
-    int viewportLines = std::max(1,(height_ - 40 - lineH_)/lineH_);
     // Snap scroll to target immediately for responsiveness
     if (t.scrollOffsetTargetLines < 0) t.scrollOffsetTargetLines = 0;
     t.scrollOffsetLines = t.scrollOffsetTargetLines;
-    int bottomStart = std::max(0,(int)lines.size()-viewportLines);
+    int bottomStart = std::max(0,totalRows-viewportLines);
     int begin = std::max(0, bottomStart - std::max(0, t.scrollOffsetLines));
-    int end = std::min((int)lines.size(), begin + viewportLines);
+    int end = std::min(totalRows, begin + viewportLines);
 
     // If mapping failed or produced an off-screen line, fall back to last live line
-    if (t.childPid <= 0 && (liveLineIdxForCursor < firstLiveIdx || liveLineIdxForCursor >= (int)lines.size())) {
+    if (t.childPid <= 0 && (liveLineIdxForCursor < firstLiveIdx || liveLineIdxForCursor >= totalRows)) {
     #ifdef USE_PANGO_CAIRO
     int cols = (int)utf8_grapheme_count(MYTERM_LAYOUT, lines.empty()?std::string():lines.back());
     #else
     int cols = (int)utf8_count_codepoints(lines.empty()?std::string():lines.back());
     #endif
-    liveLineIdxForCursor = std::max(firstLiveIdx, (int)lines.size()-1);
+    liveLineIdxForCursor = std::max(firstLiveIdx, totalRows-1);
     cursorColForLive = cols;
     }
 
@@ -886,37 +946,57 @@ void TerminalWindow::drawTextArea() {
         liveHScrollCols = std::max(0, cursorColForLive - (maxCols - 1));
     }
 
+    // Gather the visible rows, mapping the first one to (logical line, wrapped row) and
+    // walking forward from there. paintRows() then draws only the rows that changed.
+    size_t sbLine = 0;
+    int sbRow = 0;
+    if (begin < sbRows) std::tie(sbLine, sbRow) = t.wrap.locate((size_t)begin);
+    if (frameRows_.size() < (size_t)viewportLines) frameRows_.resize((size_t)viewportLines);
     for (int i=begin;i<end;++i) {
-#ifdef USE_PANGO_CAIRO
-        // Clip rendering to the text area width to avoid overflow, ensuring descenders are visible
-        ensureCairoSurface();
-        cairo_save(cr_);
-    cairo_rectangle(cr_, 10, y - pangoAscent_ - 1, std::max(0, width_ - 20), pangoAscent_ + pangoDescent_ + 2);
-        cairo_clip(cr_);
-    int drawX = 10;
-    if (i == liveLineIdxForCursor && liveHScrollCols > 0) {
-            drawX -= liveHScrollCols * charWidth();
+        FrameRow& fr = frameRows_[(size_t)(i - begin)];
+        fr.runs.clear();
+        fr.styled = fr.cells = false;
+        if (i < sbRows) {
+            while (sbRow >= t.wrap.rows(sbLine)) { ++sbLine; sbRow = 0; }
+            auto range = t.wrap.rowRange(sbLine, sbRow++);
+            fr.text.assign(t.scrollback.line(sbLine).substr(range.first, range.second - range.first));
+            // Runs are line-relative; rebase them on this row
+            t.scrollback.lineRuns(sbLine, fr.runs);
+            for (StyleRun& r : fr.runs) {
+                size_t a = std::max<size_t>(r.start, range.first), b = std::min<size_t>((size_t)r.start + r.len, range.second);
+                r.start = (uint32_t)(a - std::min(a, range.first));
+                r.len = (uint32_t)(b > a ? b - a : 0);
+            }
+            fr.styled = true;
+        } else {
+            fr.text = lines[i - sbRows];
         }
-    bool isLiveGrid = (t.childPid <= 0 && !autocompleteChoiceActive_ && i >= firstLiveIdx);
-    drawMaybeColoredPromptLine(drawX, y, lines[i], isLiveGrid);
-        cairo_restore(cr_);
-#else
-        int drawX = 10;
-        if (i == liveLineIdxForCursor && liveHScrollCols > 0) drawX -= liveHScrollCols * charWidth();
-    bool isLiveGrid = (t.childPid <= 0 && !autocompleteChoiceActive_ && i >= firstLiveIdx);
-    drawMaybeColoredPromptLine(drawX, y, lines[i], isLiveGrid);
-#endif
-        y+=lineH_;
-    }
-
-    // Visual scrollbar reflects total lines including live prompt line
-    drawScrollBar((int)lines.size(), viewportLines, begin);
-
-    // Draw cursor only if the cursor's live line is visible within the current viewport
-    if (t.childPid <= 0 && !autocompleteChoiceActive_ && (focused_ ? cursorOn_ : true)) {
+        fr.x = 10;
+        if (i == liveLineIdxForCursor && liveHScrollCols > 0) fr.x -= liveHScrollCols * charWidth();
+        fr.grid = (t.childPid <= 0 && !autocompleteChoiceActive_ && i >= firstLiveIdx);
+    }
+    const bool rowsDrawn = paintRows(viewportLines, end - begin, totalRows > viewportLines);
+
+    // Visual scrollbar reflects total lines including live prompt line; it sits on top of the
+    // rows' right edge, so it is repainted whenever a row under it was
+    uint64_t sbKey = fnv1a_mix(fnv1a_mix(fnv1a_mix(fnv1a_mix(kFnvBasis, (uint64_t)totalRows), (uint64_t)viewportLines),
+                                         (uint64_t)begin), hoverScrollbarThumb_ ? 1 : 0);
+    if (rowsDrawn || sbKey != scrollBarKey_) {
+        drawScrollBar(totalRows, viewportLines, begin);
+        // Repainted rows are presented whole; the rest of the bar only needs it if the thumb moved
+        if (sbKey != scrollBarKey_) scrollBarDamaged_ = true;
+        scrollBarKey_ = sbKey;
+    }
+    lastTotalLines_ = totalRows;
+    lastViewportLines_ = viewportLines;
+    lastBeginLine_ = begin;
+
+    // The caret is an overlay on the window (see updateCaret), placed only if its live line is visible
+    caret_ = Caret{};
+    if (t.childPid <= 0 && !autocompleteChoiceActive_) {
         if (liveLineIdxForCursor >= begin && liveLineIdxForCursor < end) {
             // If cursor is on the last line, ensure we scroll to bottom for visibility
-            if (liveLineIdxForCursor == (int)lines.size() - 1 && t.scrollOffsetLines == 0) {
+            if (liveLineIdxForCursor == totalRows - 1 && t.scrollOffsetLines == 0) {
                 t.scrollOffsetTargetLines = 0;
                 t.scrollOffsetLines = 0;
             }
@@ -925,41 +1005,18 @@ void TerminalWindow::drawTextArea() {
             // cursorCol already includes prefix columns
             int baseX = 10; // drawing starts at x=10
             int cellLeftX = baseX + (cursorColForLive - liveHScrollCols)*charW;
-            // Draw caret at the LEFT edge of the current cell (between characters)
-            int drawW = 2; // slim caret width
-            int caretX = cellLeftX; // boundary position between cells
-            int ascent =
-#ifdef USE_PANGO_CAIRO
-                (pangoAscent_ ? pangoAscent_ : (font_ ? font_->ascent : (lineH_ - 4)));
-#else
-                (font_ ? font_->ascent : (lineH_ - 4));
-#endif
-            int descent =
-#ifdef USE_PANGO_CAIRO
-                (pangoDescent_ ? pangoDescent_ : (font_ ? font_->descent : 2));
-#else
-                (font_ ? font_->descent : 2);
-#endif
-            int top = yLine - ascent;
-            int height = ascent + descent;
-            XSetForeground(dpy_, gc_, theme_.cursor);
-            if (focused_) {
-                // Slim solid bar at right cell edge
-                XFillRectangle(dpy_, win_, gc_, caretX, top, drawW, height);
-                // Subtle underline at the baseline for extra visibility
-                int baselineY = yLine; // baseline is yLine
-                XFillRectangle(dpy_, win_, gc_, caretX, baselineY, drawW, 1);
-            } else {
-                // Unfocused: even slimmer bar
-                XFillRectangle(dpy_, win_, gc_, caretX, top, 2, height);
-            }
-            XSetForeground(dpy_, gc_, theme_.fg);
+            // Slim bar at the LEFT edge of the current cell (between characters)
+            caret_.x = cellLeftX;
+            caret_.y = yLine - rowAscent();
+            caret_.w = 2;
+            caret_.h = rowAscent() + rowDescent() + 1; // reaches the baseline underline
+            caret_.valid = true;
         } else {
             // If caret would be off-screen, only auto-reveal when at bottom; if user scrolled up, don't force jump
             if (t.scrollOffsetLines == 0) {
                 int viewportLines2 = std::max(1,(height_ - 40 - lineH_)/lineH_);
                 int targetBegin = std::max(0, liveLineIdxForCursor - (viewportLines2 - 1));
-                int bottomStart2 = std::max(0,(int)lines.size()-viewportLines2);
+                int bottomStart2 = std::max(0,totalRows-viewportLines2);
                 t.scrollOffsetTargetLines = std::max(0, bottomStart2 - targetBegin);
                 cursorOn_ = true;
             }
@@ -967,6 +1024,269 @@ void TerminalWindow::drawTextArea() {
     }
 }
 
+// Full-screen program on the alternate screen: draw its cell grid as is, with no
+// scrollback, prompt or scrollbar, and the program's own cursor.
+void TerminalWindow::drawAltScreen(Tab& t) {
+    const int slots = viewportRows();
+    const int rows = std::min(t.vt.rows(), slots);
+    if (frameRows_.size() < (size_t)slots) frameRows_.resize((size_t)slots);
+    for (int r = 0; r < rows; ++r) {
+        const StyledText& row = t.vt.rowText(r);
+        FrameRow& fr = frameRows_[(size_t)r];
+        fr.text = row.text;
+        fr.runs = row.runs;
+        fr.x = 10;
+        fr.styled = fr.cells = true;
+        fr.grid = false;
+    }
+    paintRows(slots, rows, false);
+    t.vt.clearDirty();
+    lastTotalLines_ = rows;
+    lastViewportLines_ = rows;
+    lastBeginLine_ = 0;
+
+    caret_ = Caret{};
+    if (!t.vt.cursorVisible() || t.vt.cursorRow() >= rows) return;
+    // Block outline: the cell under it stays readable
+    caret_.x = 10 + t.vt.cursorCol() * charWidth();
+    caret_.y = 40 + lineH_ + t.vt.cursorRow() * lineH_ - rowAscent();
+    caret_.w = std::max(2, charWidth());
+    caret_.h = rowAscent() + rowDescent();
+    caret_.outline = true;
+    caret_.valid = true;
+}
+
+// multiWatch: one pane per command in a near-square grid filling the text area. A pane
+// holds a title row (the header of the round it shows) over the output of that round,
+// cut to the pane, over a footer row with the command's runtime summary; lines that do
+// not fit are counted in the last body row. With -d, lines that changed since the
+// round before sit on a highlighted band.
+void TerminalWindow::drawWatchPanes(Tab& t) {
+    const auto& panes = t.watch.panes();
+    const int n = (int)panes.size();
+    caret_ = Caret{};
+    lastTotalLines_ = lastViewportLines_ = 1;
+    lastBeginLine_ = 0;
+    if (paneTab_ != &t || paneViews_.size() != (size_t)n) {
+        paneViews_.assign((size_t)n, PaneView{});
+        paneTab_ = &t;
+        XSetForeground(dpy_, gc_, theme_.bg);
+        XFillRectangle(dpy_, win_, gc_, 0, 40, (unsigned)width_, (unsigned)std::max(0, height_ - 40));
+        addDamage(40, height_);
+    }
+    if (n == 0) return;
+    int gridCols = 1;
+    while (gridCols * gridCols < n) ++gridCols;
+    const int gridRows = (n + gridCols - 1) / gridCols;
+    const int areaH = std::max(0, height_ - 40);
+    const int charW = std::max(1, charWidth());
+    const int pad = 4;
+    for (int i = 0; i < n; ++i) {
+        const WatchPanes::Pane& pane = panes[(size_t)i];
+        PaneView& pv = paneViews_[(size_t)i];
+        const int gc = i % gridCols, gr = i / gridCols;
+        const int x = gc * width_ / gridCols, y = 40 + gr * areaH / gridRows;
+        const int w = (gc + 1) * width_ / gridCols - x, h = 40 + (gr + 1) * areaH / gridRows - y;
+        if (x != pv.x || y != pv.y || w != pv.w || h != pv.h) {
+            pv = PaneView{};
+            pv.x = x; pv.y = y; pv.w = w; pv.h = h;
+        }
+        const size_t cols = (size_t)std::max(1, (w - 2 * pad) / charW);
+        const int top = y + lineH_ + 2 * pad + 1;      // body, below the title separator
+        const int footTop = y + h - lineH_ - 2 * pad - 1; // footer separator
+        const int bodyRows = std::max(0, (footTop - top - pad) / lineH_);
+        auto clip = [&](const std::string& s) {
+            if (s.size() <= cols) return s; // ASCII fits: bytes bound graphemes from above
+            return utf8_grapheme_count(MYTERM_LAYOUT, s) <= cols ? s : utf8_substr_grapheme(MYTERM_LAYOUT, s, 0, cols);
+        };
+        if (pv.laidOut != pane.contentVersion) {
+            pv.rows.clear();
+            pv.changed.clear();
+            const size_t total = pane.lines.size();
+            const bool more = total > (size_t)bodyRows || pane.truncated;
+            const size_t shown = std::min(total, (size_t)std::max(0, more ? bodyRows - 1 : bodyRows));
+            for (size_t k = 0; k < shown; ++k) {
+                pv.rows.push_back(clip(pane.lines[k]));
+                pv.changed.push_back(k < pane.changed.size() ? pane.changed[k] : 0);
+            }
+            if (more && bodyRows > 0) {
+                std::string note = pane.truncated ? "[output truncated]" : "[" + std::to_string(total - shown) + " more lines]";
+                pv.rows.push_back(clip(note));
+                pv.changed.push_back(0);
+            }
+            pv.laidOut = pane.contentVersion;
+        }
+        const uint64_t geom = fnv1a_mix(fnv1a_mix(kFnvBasis, ((uint64_t)(uint32_t)x << 32) | (uint32_t)y), ((uint64_t)(uint32_t)w << 32) | (uint32_t)h);
+        const uint64_t titleKey = fnv1a_mix(geom, pane.titleVersion) | 1;
+        const uint64_t bodyKey = fnv1a_mix(fnv1a_mix(geom, pane.contentVersion), 0x9e3779b97f4a7c15ull) | 1;
+        const uint64_t footKey = fnv1a_mix(fnv1a_mix(geom, pane.statsVersion), 0xc2b2ae3d27d4eb4full) | 1;
+        if (titleKey != pv.titleKey) {
+            XSetForeground(dpy_, gc_, theme_.bg);
+            XFillRectangle(dpy_, win_, gc_, x, y, (unsigned)w, (unsigned)(lineH_ + 2 * pad));
+            XSetForeground(dpy_, gc_, theme_.gray);
+            XDrawRectangle(dpy_, win_, gc_, x, y, (unsigned)std::max(1, w - 1), (unsigned)std::max(1, h - 1));
+            XDrawLine(dpy_, win_, gc_, x, y + lineH_ + 2 * pad, x + w - 1, y + lineH_ + 2 * pad);
+            drawAnsiText(x + pad, y + pad + rowAscent(), clip(pane.title), theme_.accent);
+            addDamage(y, y + lineH_ + 2 * pad + 1);
+            pv.titleKey = titleKey;
+        }
+        if (bodyKey != pv.bodyKey) {
+            XSetForeground(dpy_, gc_, theme_.bg);
+            XFillRectangle(dpy_, win_, gc_, x + 1, top, (unsigned)std::max(0, w - 2), (unsigned)std::max(0, footTop - top));
+#ifdef USE_PANGO_CAIRO
+            cairo_save(cr_);
+            cairo_rectangle(cr_, x + 1, top, std::max(0, w - 2), std::max(0, footTop - top));
+            cairo_clip(cr_);
+#endif
+            for (size_t k = 0; k < pv.rows.size(); ++k) {
+                const int rowY = top + pad + (int)k * lineH_;
+                if (pv.changed[k]) {
+                    XSetForeground(dpy_, gc_, theme_.changedBg);
+                    XFillRectangle(dpy_, win_, gc_, x + 1, rowY, (unsigned)std::max(0, w - 2), (unsigned)lineH_);
+                }
+                drawAnsiText(x + pad, rowY + rowAscent(), pv.rows[k], theme_.fg);
+            }
+#ifdef USE_PANGO_CAIRO
+            cairo_restore(cr_);
+#endif
+            addDamage(top, footTop);
+            pv.bodyKey = bodyKey;
+        }
+        if (footKey != pv.footKey && footTop > top) {
+            XSetForeground(dpy_, gc_, theme_.bg);
+            XFillRectangle(dpy_, win_, gc_, x + 1, footTop, (unsigned)std::max(0, w - 2), (unsigned)std::max(0, y + h - 1 - footTop));
+            XSetForeground(dpy_, gc_, theme_.gray);
+            XDrawLine(dpy_, win_, gc_, x, footTop, x + w - 1, footTop);
+            drawAnsiText(x + pad, footTop + 1 + pad + rowAscent(), clip(pane.stats), theme_.blue);
+            addDamage(footTop, y + h);
+            pv.footKey = footKey;
+        }
+    }
+}
+
+int TerminalWindow::rowAscent() const {
+#ifdef USE_PANGO_CAIRO
+    if (pangoAscent_) return pangoAscent_;
+#endif
+    return font_ ? font_->ascent : (lineH_ - 4);
+}
+
+int TerminalWindow::rowDescent() const {
+#ifdef USE_PANGO_CAIRO
+    if (pangoDescent_) return pangoDescent_;
+#endif
+    return font_ ? font_->descent : 2;
+}
+
+// Top of the band of screen row `slot` (baseline 40 + lineH_ + slot*lineH_); bands tile
+// the text area and each holds everything drawn for its row, backgrounds and underlines included
+int TerminalWindow::rowTop(int slot) const {
+    return 40 + lineH_ + slot * lineH_ - rowAscent() - std::max(0, lineH_ - rowAscent() - rowDescent()) / 2;
+}
+
+void TerminalWindow::addDamage(int y0, int y1) {
+    damageY0_ = std::min(damageY0_, std::max(0, y0));
+    damageY1_ = std::max(damageY1_, std::min(height_, y1));
+}
+
+// Bring the back buffer's text rows up to date with frameRows_[0, used) (rows past
+// `used` are blank). Each row's content is hashed and compared with what its band
+// shows now. When the content moved by whole rows (new output scrolling the view, the
+// wheel), the bands are shifted with one XCopyArea first; afterwards only rows whose
+// hash still differs are cleared and drawn. Returns true if any pixels changed.
+bool TerminalWindow::paintRows(int slots, int used, bool scrollBar) {
+    constexpr uint64_t kUnknownRow = 0, kBlankRow = 1;
+    nextKeys_.assign((size_t)slots, kBlankRow);
+    for (int s = 0; s < used; ++s) {
+        const FrameRow& fr = frameRows_[(size_t)s];
+        uint64_t h = fnv1a_bytes(kFnvBasis, fr.text.data(), fr.text.size());
+        for (const StyleRun& r : fr.runs) {
+            h = fnv1a_mix(h, ((uint64_t)r.start << 32) | r.len);
+            h = fnv1a_mix(h, ((uint64_t)r.style.fg << 24) | ((uint64_t)r.style.bg << 8) | r.style.flags);
+        }
+        h = fnv1a_mix(h, (uint64_t)(uint32_t)fr.x | ((uint64_t)fr.styled << 32) | ((uint64_t)fr.grid << 33) | ((uint64_t)fr.cells << 34));
+        nextKeys_[(size_t)s] = h <= kBlankRow ? h + 2 : h;
+    }
+
+    bool changed = false;
+    if (scrollBar != scrollBarShown_ || rowKeys_.size() != (size_t)slots) {
+        // Geometry changed: start the text area over
+        XSetForeground(dpy_, gc_, theme_.bg);
+        XFillRectangle(dpy_, win_, gc_, 0, 40, (unsigned)width_, (unsigned)std::max(0, height_ - 40));
+        addDamage(40, height_);
+        rowKeys_.assign((size_t)slots, kUnknownRow);
+        scrollBarShown_ = scrollBar;
+        changed = true;
+    } else {
+        // Find the shift that lines up the most rows: anchor on the first non-blank new row
+        int shift = 0;
+        auto score = [&](int k) {
+            int n = 0;
+            for (int s = std::max(0, -k); s < slots && s + k < slots; ++s)
+                if (nextKeys_[(size_t)s] != kBlankRow && nextKeys_[(size_t)s] == rowKeys_[(size_t)(s + k)]) ++n;
+            return n;
+        };
+        int anchor = 0;
+        while (anchor < slots && nextKeys_[(size_t)anchor] == kBlankRow) ++anchor;
+        if (anchor < slots) {
+            int best = score(0);
+            for (int m = 0; m < slots; ++m) {
+                if (m == anchor || rowKeys_[(size_t)m] != nextKeys_[(size_t)anchor]) continue;
+                int k = m - anchor, sc = score(k);
+                if (sc > best) { best = sc; shift = k; }
+                break;
+            }
+        }
+        if (shift != 0) {
+            int n = slots - std::abs(shift);
+            int src = shift > 0 ? shift : 0, dst = shift > 0 ? 0 : -shift;
+            XCopyArea(dpy_, win_, win_, gc_, 0, rowTop(src), (unsigned)width_, (unsigned)(n * lineH_), 0, rowTop(dst));
+            std::vector<uint64_t> moved((size_t)slots, kUnknownRow);
+            for (int i = 0; i < n; ++i) moved[(size_t)(dst + i)] = rowKeys_[(size_t)(src + i)];
+            rowKeys_.swap(moved);
+            addDamage(rowTop(dst), rowTop(dst) + n * lineH_);
+            changed = true;
+        }
+    }
+
+    for (int s = 0; s < slots; ++s) {
+        if (rowKeys_[(size_t)s] == nextKeys_[(size_t)s]) continue;
+        rowKeys_[(size_t)s] = nextKeys_[(size_t)s];
+        changed = true;
+        XSetForeground(dpy_, gc_, theme_.bg);
+        XFillRectangle(dpy_, win_, gc_, 0, rowTop(s), (unsigned)width_, (unsigned)lineH_);
+        addDamage(rowTop(s), rowTop(s) + lineH_);
+        if (s >= used) continue;
+        const FrameRow& fr = frameRows_[(size_t)s];
+        int y = 40 + lineH_ + s * lineH_;
+#ifdef USE_PANGO_CAIRO
+        // Clip rendering to the text area width to avoid overflow, ensuring descenders are visible
+        cairo_save(cr_);
+        cairo_rectangle(cr_, 10, y - pangoAscent_ - 1, std::max(0, width_ - 20), pangoAscent_ + pangoDescent_ + 2);
+        cairo_clip(cr_);
+#endif
+        if (fr.cells) drawStyledText(fr.x, y, fr.text, &fr.runs, 0, true);
+        else drawMaybeColoredPromptLine(fr.x, y, fr.text, fr.grid, fr.styled ? &fr.runs : nullptr);
+#ifdef USE_PANGO_CAIRO
+        cairo_restore(cr_);
+#endif
+    }
+    return changed;
+}
+
+// The caret is not part of the back buffer: it is drawn straight onto the window, and
+// erased by copying the cell back from the buffer. A blink costs two small requests.
+void TerminalWindow::updateCaret() {
+    if (caretShown_.valid) back_.present(win_, gc_, caretShown_.x, caretShown_.y, caretShown_.w, caretShown_.h);
+    caretShown_ = Caret{};
+    if (!caret_.valid || (focused_ && !cursorOn_)) return;
+    XSetForeground(dpy_, gc_, theme_.cursor);
+    if (caret_.outline) XDrawRectangle(dpy_, win_, gc_, caret_.x, caret_.y, (unsigned)(caret_.w - 1), (unsigned)(caret_.h - 1));
+    else XFillRectangle(dpy_, win_, gc_, caret_.x, caret_.y, (unsigned)caret_.w, (unsigned)caret_.h);
+    XSetForeground(dpy_, gc_, theme_.fg);
+    caretShown_ = caret_;
+}
+
 void TerminalWindow::drawColoredPromptLine(int x, int y, const std::string& line) {
     // Split and draw: user@host: in green, cwd in blue, "$ " and input in fg.
     std::string u = get_user();
@@ -992,7 +1312,7 @@ void TerminalWindow::drawColoredPromptLine(int x, int y, const std::string& line
     }
 }
 
-void TerminalWindow::drawMaybeColoredPromptLine(int x, int y, const std::string& line, bool gridMode) {
+void TerminalWindow::drawMaybeColoredPromptLine(int x, int y, const std::string& line, bool gridMode, const std::vector<StyleRun>* runs) {
     // Detect lines that look like our prompt: user@host:cwd$ rest
     std::string u = get_user();
     std::string h = get_host();
@@ -1011,13 +1331,13 @@ void TerminalWindow::drawMaybeColoredPromptLine(int x, int y, const std::string&
             advance += drawTextAdvance(x + advance, y, cwd, theme_.blue, 0);
             // "$ "
             advance += drawTextAdvance(x + advance, y, std::string("$ "), theme_.fg, 0);
-            // rest (may include ANSI sequences if from scrollback)
+            // rest (styled by the line's runs if from scrollback)
             if (!rest.empty()) {
                 if (gridMode) {
                     // Grid mode: measure as terminal cells; avoid natural advance variance
                     advance += drawTextAdvance(x + advance, y, rest, theme_.fg, 0);
                 } else {
-                    drawAnsiTextWithParsing(x + advance, y, rest);
+                    drawStyledText(x + advance, y, rest, runs, pos_dollar + 2);
                 }
             }
             return;
@@ -1027,147 +1347,182 @@ void TerminalWindow::drawMaybeColoredPromptLine(int x, int y, const std::string&
     if (gridMode) {
         drawTextAdvance(x, y, line, theme_.fg, 0);
     } else {
-        drawAnsiTextWithParsing(x, y, line);
+        drawStyledText(x, y, line, runs, 0);
     }
 }
 
-void TerminalWindow::drawAnsiTextWithParsing(int x, int y, const std::string& text) {
-    unsigned long currentFg = theme_.fg;
-    unsigned long currentBg = theme_.bg;
+// Draw text using pre-decoded style runs (starts relative to the line; `base` is where
+// `text` begins in that line). Gaps between runs use the default colors. With cellAligned,
+// cells are counted as VtScreen lays them out (a combining mark shares its base's cell),
+// so chunks land on the grid's columns.
+void TerminalWindow::drawStyledText(int x, int y, const std::string& text, const std::vector<StyleRun>* runs, size_t base, bool cellAligned) {
     int currentX = x;
-    size_t i = 0;
-    auto drawChunkNatural = [&](const std::string& chunk){
+    int cell = 0;
+    auto drawChunk = [&](size_t a, size_t b, const TextStyle& st) {
+        if (a >= b) return;
+        int cells = 0;
+        if (cellAligned) {
+            cells = (int)cellCount(std::string_view(text).substr(a, b - a));
+            currentX = x + cell * charWidth();
+            cell += cells;
+        }
+        unsigned long fg = st.fg == TextStyle::kDefaultColor ? theme_.fg : ansiColorToPixel(st.fg, true);
+        unsigned long bg = st.bg == TextStyle::kDefaultColor ? theme_.bg : ansiColorToPixel(st.bg, false);
+        if (st.flags & TextStyle::Inverse) std::swap(fg, bg);
 #ifdef USE_PANGO_CAIRO
         ensureCairoSurface();
-        // Convert X11 pixel to RGB components (approximate)
-        XColor c; c.pixel = currentFg; XQueryColor(dpy_, cmap_, &c);
-        double r = c.red / 65535.0, g = c.green / 65535.0, b = c.blue / 65535.0;
-        cairo_set_source_rgb(cr_, r, g, b);
-        std::string safe = sanitize_to_valid_utf8(chunk);
-    pango_layout_set_text(pangoLayout_, safe.c_str(), (int)safe.size());
-    pango_layout_set_font_description(pangoLayout_, pangoFontDesc_);
-        int baseline_px = pango_layout_get_baseline(pangoLayout_) / PANGO_SCALE;
-        int top_y = y - baseline_px;
-        cairo_move_to(cr_, currentX, top_y);
-        // optional background fill for the chunk
-        PangoRectangle logical; pango_layout_get_pixel_extents(pangoLayout_, nullptr, &logical);
-        if (currentBg != theme_.bg) {
-            // Approximate bg behind text
-            XSetForeground(dpy_, gc_, currentBg);
-            XFillRectangle(dpy_, win_, gc_, currentX, y - (pango_layout_get_baseline(pangoLayout_) / PANGO_SCALE), logical.width, pangoAscent_ + pangoDescent_);
-            XSetForeground(dpy_, gc_, theme_.fg);
-            // Redraw text atop bg
-            cairo_move_to(cr_, currentX, y - (pango_layout_get_baseline(pangoLayout_) / PANGO_SCALE));
-            pango_cairo_show_layout(cr_, pangoLayout_);
-        } else {
-            pango_cairo_show_layout(cr_, pangoLayout_);
+        std::string safe = sanitize_to_valid_utf8(std::string_view(text).substr(a, b - a));
+        if (bg != theme_.bg) {
+            // Background behind the chunk
+            int bgW = cellAligned ? cells * charWidth() : (int)utf8_grapheme_count(pangoLayout_, safe) * charWidth();
+            XSetForeground(dpy_, gc_, bg);
+            XFillRectangle(dpy_, win_, gc_, currentX, y - pangoAscent_, bgW, pangoAscent_ + pangoDescent_);
         }
-        // advance by natural pixel width
-        currentX += logical.width;
+        uint8_t style = 0;
+        if (st.flags & TextStyle::Bold) style |= GlyphAtlas::kBold;
+        if (st.flags & TextStyle::Italic) style |= GlyphAtlas::kItalic;
+        setSourcePixel(fg, (st.flags & TextStyle::Dim) ? 0.6 : 1.0);
+        int clusters = drawClusters(currentX, y, safe, style);
+        // advance by whole cells (per cluster, or per code point on the grid)
+        int w = (cellAligned ? cells : clusters) * charWidth();
 #else
-    // Approximate background fill for ANSI bg colors in core X11 path
-    if (currentBg != theme_.bg) {
-        XSetForeground(dpy_, gc_, currentBg);
-        int w = (int)chunk.size() * charWidth();
+        int w = (cellAligned ? cells : (int)(b - a)) * charWidth();
         int asc = font_ ? font_->ascent : (lineH_ - 4);
         int desc = font_ ? font_->descent : 2;
-        XFillRectangle(dpy_, win_, gc_, currentX, y - asc, w, asc + desc);
-    }
-    XSetForeground(dpy_, gc_, currentFg);
-    XDrawString(dpy_, win_, gc_, currentX, y, chunk.c_str(), (int)chunk.size());
-    currentX += (int)chunk.size() * charWidth();
+        if (bg != theme_.bg) {
+            XSetForeground(dpy_, gc_, bg);
+            XFillRectangle(dpy_, win_, gc_, currentX, y - asc, w, asc + desc);
+        }
+        XSetForeground(dpy_, gc_, fg);
+        XDrawString(dpy_, win_, gc_, currentX, y, text.c_str() + a, (int)(b - a));
+        // Core fonts have no bold face at hand: overstrike one pixel to the right
+        if (st.flags & TextStyle::Bold) XDrawString(dpy_, win_, gc_, currentX + 1, y, text.c_str() + a, (int)(b - a));
 #endif
+        if (st.flags & (TextStyle::Underline | TextStyle::Strike)) {
+            XSetForeground(dpy_, gc_, fg);
+            if (st.flags & TextStyle::Underline) XFillRectangle(dpy_, win_, gc_, currentX, y + 1, w, 1);
+            if (st.flags & TextStyle::Strike) XFillRectangle(dpy_, win_, gc_, currentX, y - lineH_ / 4, w, 1);
+        }
+        XSetForeground(dpy_, gc_, theme_.fg);
+        currentX += w;
     };
-    while (i < text.size()) {
-        if (text[i] == '\x1B' && i+1 < text.size() && text[i+1] == '[') {
-            // ANSI CSI
-            size_t end = i+2;
-            while (end < text.size() && text[end] != 'm') end++;
-            if (end < text.size()) {
-                std::string seq = text.substr(i+2, end - (i+2));
-                // Parse SGR
-                std::vector<int> codes;
-                size_t pos = 0;
-                while (pos < seq.size()) {
-                    size_t next = seq.find(';', pos);
-                    if (next == std::string::npos) next = seq.size();
-                    if (pos < next) {
-                        codes.push_back(std::stoi(seq.substr(pos, next - pos)));
-                    }
-                    pos = next + 1;
-                }
-                for (int code : codes) {
-                    if (code == 0) { currentFg = theme_.fg; currentBg = theme_.bg; }
-                    else if (code >= 30 && code <= 37) currentFg = ansiColorToPixel(code - 30, true);
-                    else if (code >= 40 && code <= 47) currentBg = ansiColorToPixel(code - 40, false);
-                    else if (code >= 90 && code <= 97) currentFg = ansiColorToPixel(code - 82, true); // bright
-                    else if (code >= 100 && code <= 107) currentBg = ansiColorToPixel(code - 92, false);
-                    // Skip 38/48 for now
-                }
-                (void)currentBg; // silence potential set-but-not-used in analysis
-                i = end + 1;
-                continue;
-            }
+    size_t pos = 0;
+    if (runs) {
+        for (const StyleRun& r : *runs) {
+            size_t end = (size_t)r.start + r.len;
+            if (end <= base) continue;
+            size_t a = r.start > base ? r.start - base : 0;
+            if (a >= text.size()) break;
+            size_t b = std::min(text.size(), end - base);
+            drawChunk(pos, a, TextStyle{});
+            drawChunk(a, b, r.style);
+            pos = b;
         }
-        // Find next escape or end
-        size_t nextEsc = text.find('\x1B', i);
-        if (nextEsc == std::string::npos) nextEsc = text.size();
-        std::string chunk = text.substr(i, nextEsc - i);
-        // Scrollback/output lines may contain mixed-width scripts; draw with natural spacing to avoid overlaps.
-        drawChunkNatural(chunk);
-        i = nextEsc;
-    }
-}
-
-void TerminalWindow::redraw() {
-    // Create double buffer to prevent flickering
-    Pixmap pixmap = XCreatePixmap(dpy_, win_, width_, height_, DefaultDepth(dpy_, screen_));
-    GC pixGC = XCreateGC(dpy_, pixmap, 0, nullptr);
-    if (font_) XSetFont(dpy_, pixGC, font_->fid);
-    
-    // Clear background
-    XSetForeground(dpy_, pixGC, theme_.bg);
-    XFillRectangle(dpy_, pixmap, pixGC, 0, 0, width_, height_);
-    
-    // Temporarily switch drawing context to pixmap
-    Window oldWin = win_;
-    GC oldGC = gc_;
-    win_ = pixmap;
-    gc_ = pixGC;
-    
+    }
+    drawChunk(pos, text.size(), TextStyle{});
+}
+
+bool TerminalWindow::ensureBackBuffer() {
+    return back_.resize(dpy_, win_, width_, height_, font_ ? font_->fid : 0);
+}
+
+static unsigned long long monotonic_us() {
+    timespec ts{}; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ull + (unsigned long long)ts.tv_nsec / 1000ull;
+}
+
+void TerminalWindow::setFrameRate(int hz) {
+    frameIntervalUs_ = 1000000 / std::clamp(hz, 1, 1000);
+}
+
+void TerminalWindow::requestFrame(bool fromOutput) {
+    frameDue_ = true;
+    if (!fromOutput) frameInteractive_ = true;
+}
+
+// Bring the back buffer up to date and show what changed. Parts of the frame whose
+// content is unchanged (tab bar, rows, scrollbar) are left alone; only the band of
+// rows that was painted is copied to the window, and the caret is redone on top.
+void TerminalWindow::renderFrame() {
+    if (ensureBackBuffer()) frameValid_ = false;
 #ifdef USE_PANGO_CAIRO
-    // Recreate Cairo surface for double buffer
-    if (cairoSurface_) cairo_surface_destroy(cairoSurface_);
-    cairoSurface_ = cairo_xlib_surface_create(dpy_, pixmap, DefaultVisual(dpy_, screen_), width_, height_);
-    if (cr_) cairo_destroy(cr_);
-    cr_ = cairo_create(cairoSurface_);
+    ensureCairoSurface();
 #endif
-    
+
+    // Temporarily switch drawing context to the back buffer
+    Window oldWin = win_;
+    GC oldGC = gc_;
+    win_ = back_.pixmap();
+    gc_ = back_.gc();
+
+    damageY0_ = height_;
+    damageY1_ = 0;
+    scrollBarDamaged_ = false;
+    // Switching between the text rows and a pane grid starts the text area over
+    const bool panes = !tabs_.empty() && tabs_[activeTab_]->watchActive;
+    if (panes != panesShown_) { frameValid_ = false; panesShown_ = panes; }
+    if (!frameValid_) {
+        // Clear background and forget what every part showed
+        XSetForeground(dpy_, gc_, theme_.bg);
+        XFillRectangle(dpy_, win_, gc_, 0, 0, width_, height_);
+        rowKeys_.clear();
+        paneViews_.clear();
+        tabBarKey_ = scrollBarKey_ = 0;
+        addDamage(0, height_);
+    }
+
     drawTabBar();
     drawTextArea();
-    
-    // Copy buffer to window
+
+    // Copy the repainted band to the window
     win_ = oldWin;
     gc_ = oldGC;
-    XCopyArea(dpy_, pixmap, win_, gc_, 0, 0, width_, height_, 0, 0);
-    
-    // Cleanup
-    XFreeGC(dpy_, pixGC);
-    XFreePixmap(dpy_, pixmap);
-    
-#ifdef USE_PANGO_CAIRO
-    // Restore Cairo surface for window
-    if (cairoSurface_) cairo_surface_destroy(cairoSurface_);
-    cairoSurface_ = cairo_xlib_surface_create(dpy_, win_, DefaultVisual(dpy_, screen_), width_, height_);
-    if (cr_) cairo_destroy(cr_);
-    cr_ = cairo_create(cairoSurface_);
-#endif
-    
+    if (damageY1_ > damageY0_) back_.present(win_, gc_, 0, damageY0_, width_, damageY1_ - damageY0_);
+    if (scrollBarDamaged_) back_.present(win_, gc_, width_ - 16, 40, 16, height_ - 40);
+    frameValid_ = true;
+    updateCaret();
     XFlush(dpy_);
+
+    // Back off while output floods in, so parsing rather than drawing bounds throughput
+    frameSkip_ = ingestedBytes_ > kFloodBytesPerFrame ? std::min(kMaxFrameSkip, frameSkip_ * 2 + 1) : 0;
+    ingestedBytes_ = 0;
+    frameDue_ = frameInteractive_ = false;
+    lastFrameUs_ = monotonic_us();
 }
 
 // Xft helper removed in revert
 
+// Bytes an xterm sends for a special key; empty for keys whose text is sent as is
+static std::string xterm_key_sequence(KeySym ks, bool appCursor) {
+    const char* cur = appCursor ? "\x1bO" : "\x1b[";
+    switch (ks) {
+    case XK_Up: return std::string(cur) + "A";
+    case XK_Down: return std::string(cur) + "B";
+    case XK_Right: return std::string(cur) + "C";
+    case XK_Left: return std::string(cur) + "D";
+    case XK_Home: return std::string(cur) + "H";
+    case XK_End: return std::string(cur) + "F";
+    case XK_BackSpace: return "\x7f";
+    case XK_Insert: return "\x1b[2~";
+    case XK_Delete: return "\x1b[3~";
+    case XK_Page_Up: return "\x1b[5~";
+    case XK_Page_Down: return "\x1b[6~";
+    case XK_F1: return "\x1bOP";
+    case XK_F2: return "\x1bOQ";
+    case XK_F3: return "\x1bOR";
+    case XK_F4: return "\x1bOS";
+    case XK_F5: return "\x1b[15~";
+    case XK_F6: return "\x1b[17~";
+    case XK_F7: return "\x1b[18~";
+    case XK_F8: return "\x1b[19~";
+    case XK_F9: return "\x1b[20~";
+    case XK_F10: return "\x1b[21~";
+    case XK_F11: return "\x1b[23~";
+    case XK_F12: return "\x1b[24~";
+    default: return std::string();
+    }
+}
+
 void TerminalWindow::handleKeyPress(XKeyEvent* e) {
     KeySym ks = XLookupKeysym(e, 0);
 
@@ -1176,7 +1531,7 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
             int tabIdx = ks - XK_1;
             if (tabIdx < (int)tabs_.size()) {
                 activeTab_ = tabIdx;
-                redraw();
+                requestFrame();
             }
             return;
         }
@@ -1199,11 +1554,22 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
         if (sym) ks = sym; // prefer the symbol resolved by lookup
     }
 
+    // A full-screen program owns the keyboard; Ctrl+C and Ctrl+Z keep their job control below
+    if (t.childPid > 0 && t.inFdWrite >= 0 && t.vt.altActive() && !(n==1 && (txt[0]==3 || txt[0]==26))) {
+        std::string seq = xterm_key_sequence(ks, t.vt.appCursorKeys());
+        if (seq.empty() && n > 0) {
+            if (e->state & Mod1Mask) seq = "\x1b"; // Meta sends ESC prefix
+            seq.append(txt, (size_t)n);
+        }
+        if (!seq.empty()) (void)!write(t.inFdWrite, seq.data(), seq.size());
+        return;
+    }
+
     // Scrolling keys
-    if (ks == XK_Page_Up)   { t.scrollOffsetTargetLines = t.scrollOffsetLines + 10; redraw(); return; }
-    if (ks == XK_Page_Down) { t.scrollOffsetTargetLines = std::max(0, t.scrollOffsetLines - 10); redraw(); return; }
-    if ((ks == XK_Home) && (e->state & ControlMask)) { t.scrollOffsetTargetLines = 1000000; redraw(); return; }
-    if ((ks == XK_End)  && (e->state & ControlMask)) { t.scrollOffsetTargetLines = 0; redraw(); return; }
+    if (ks == XK_Page_Up)   { t.scrollOffsetTargetLines = t.scrollOffsetLines + 10; requestFrame(); return; }
+    if (ks == XK_Page_Down) { t.scrollOffsetTargetLines = std::max(0, t.scrollOffsetLines - 10); requestFrame(); return; }
+    if ((ks == XK_Home) && (e->state & ControlMask)) { t.scrollOffsetTargetLines = 1000000; requestFrame(); return; }
+    if ((ks == XK_End)  && (e->state & ControlMask)) { t.scrollOffsetTargetLines = 0; requestFrame(); return; }
 
     // Ctrl+R: enter inline history search (keep normal input intact)
     if (n==1 && txt[0]==18 && t.childPid <= 0) { // Ctrl+R
@@ -1213,7 +1579,7 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
             searchSavedCursor_ = t.cursor;
             searchTerm_.clear();
             t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-            redraw();
+            requestFrame();
             return;
         }
     }
@@ -1224,10 +1590,10 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
     if (t.childPid > 0 && !(n==1 && (txt[0]==3 || txt[0]==26))) return;
 
     // Ctrl keys
-    if (n==1 && txt[0]==1) { t.cursor = 0; redraw(); return; } // Ctrl+A
-    if (n==1 && txt[0]==5) { t.cursor = t.input.size(); redraw(); return; } // Ctrl+E
+    if (n==1 && txt[0]==1) { t.cursor = 0; requestFrame(); return; } // Ctrl+A
+    if (n==1 && txt[0]==5) { t.cursor = t.input.size(); requestFrame(); return; } // Ctrl+E
     if (n==1 && txt[0]==20) { // Ctrl+T -> new tab
-        newTab(); activeTab_ = (int)tabs_.size()-1; redraw(); return;
+        newTab(); activeTab_ = (int)tabs_.size()-1; requestFrame(); return;
     }
     if (n==1 && txt[0]==17) { // Ctrl+Q -> close current tab
         closeTab(activeTab_);
@@ -1236,8 +1602,8 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
     if (n==1 && txt[0]==12) { // Ctrl+L -> clear screen
         t.scrollback.clear();
         t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-        t.ansiState = Tab::ANSI_TEXT; t.ansiSeq.clear();
-        redraw(); return;
+        t.vt.reset();
+        requestFrame(); return;
     }
     if (n==1 && txt[0]==3) { // Ctrl+C -> interrupt foreground job or cancel current input
         if (t.childPgid > 0) {
@@ -1255,7 +1621,7 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
             t.cursor = 0;
             t.contActive = false; t.contBuffer.clear(); t.contJoinNoNewline = false;
             t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-            redraw();
+            requestFrame();
         }
         return;
     }
@@ -1270,11 +1636,13 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
             // Move to background so we keep draining and printing output continuously
             if (t.outFd >= 0 || t.errFd >= 0) {
                 BackgroundJob bj { t.childPid, t.childPgid, t.outFd, t.errFd, "[detached]", isPty };
+                bj.exited = t.childExitedPid == t.childPid;
                 t.backgroundJobs.push_back(bj);
             }
             // Mark no active foreground job; clear foreground fds but do NOT close them here
             t.childPid = -1;
             t.childPgid = -1;
+            t.childExitedPid = -1;
             t.outFd = -1;
             t.errFd = -1;
             // Important: clear inFdWrite so starting a new command won't close the detached job's PTY
@@ -1325,7 +1693,7 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
             t.input = searchSavedInput_; t.cursor = searchSavedCursor_;
             // Snap view to bottom so results are visible
             t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-            redraw();
+            requestFrame();
             return;
         } else {
             submitInputLine(t); return;
@@ -1339,17 +1707,15 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
         searchActive_ = false;
         searchTerm_.clear();
         t.input = searchSavedInput_; t.cursor = searchSavedCursor_;
-        redraw(); return;
+        requestFrame(); return;
     }
     if (ks == XK_Escape && autocompleteChoiceActive_) {
         // Cancel choice prompt
-        if (acScrollbackMark_ != (size_t)-1 && acScrollbackMark_ <= t.scrollback.size()) {
-            t.scrollback.erase(acScrollbackMark_);
-        }
+        if (acScrollbackMark_ != (size_t)-1) t.scrollback.truncate(acScrollbackMark_);
         autocompleteChoiceActive_ = false;
         autocompleteChoices_.clear();
         acScrollbackMark_ = (size_t)-1;
-        redraw(); return;
+        requestFrame(); return;
     }
 
     // Paste shortcuts: Ctrl+V, Shift+Insert
@@ -1359,16 +1725,16 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
         if (searchActive) {
             if (!searchTerm_.empty()) searchTerm_.pop_back();
             t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-            redraw(); return;
+            requestFrame(); return;
         } else {
             if (t.cursor>0) { t.input.erase(t.input.begin()+t.cursor-1); t.cursor--; }
-            redraw(); return;
+            requestFrame(); return;
         }
     }
-    if (ks == XK_Left)  { if (!searchActive && !autocompleteChoiceActive_ && t.cursor>0) t.cursor--; redraw(); return; }
-    if (ks == XK_Right) { if (!searchActive && !autocompleteChoiceActive_ && t.cursor<t.input.size()) t.cursor++; redraw(); return; }
-    if (ks == XK_Home)  { if (!searchActive) t.cursor=0; redraw(); return; }
-    if (ks == XK_End)   { if (!searchActive) t.cursor=t.input.size(); redraw(); return; }
+    if (ks == XK_Left)  { if (!searchActive && !autocompleteChoiceActive_ && t.cursor>0) t.cursor--; requestFrame(); return; }
+    if (ks == XK_Right) { if (!searchActive && !autocompleteChoiceActive_ && t.cursor<t.input.size()) t.cursor++; requestFrame(); return; }
+    if (ks == XK_Home)  { if (!searchActive) t.cursor=0; requestFrame(); return; }
+    if (ks == XK_End)   { if (!searchActive) t.cursor=t.input.size(); requestFrame(); return; }
 
     // Tab for filename autocomplete (only when no child running and not in search)
     if (ks == XK_Tab && t.childPid <= 0 && !searchActive) {
@@ -1405,17 +1771,15 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
                             if (stat(path.c_str(), &st) == 0) return S_ISDIR(st.st_mode);
                             return false;
                         };
-                        if (is_dir_choice(choice)) choice += "/";
+                        if (!acCommands_ && is_dir_choice(choice)) choice += "/";
                         // Replace token range
                         std::string before = t.input.substr(0, acReplaceStart_);
                         std::string after  = t.input.substr(acReplaceEnd_);
                         t.input = before + acDirPrefix_ + choice + after;
                         t.cursor = (before + acDirPrefix_ + choice).size();
-                        if (acScrollbackMark_ != (size_t)-1 && acScrollbackMark_ <= t.scrollback.size()) {
-                            t.scrollback.erase(acScrollbackMark_);
-                        }
+                        if (acScrollbackMark_ != (size_t)-1) t.scrollback.truncate(acScrollbackMark_);
                         autocompleteChoiceActive_ = false; autocompleteChoices_.clear(); acScrollbackMark_ = (size_t)-1;
-                        redraw();
+                        requestFrame();
                         return;
                     }
                 }
@@ -1426,11 +1790,11 @@ void TerminalWindow::handleKeyPress(XKeyEvent* e) {
         if (searchActive) {
             for (int i=0;i<n;i++) searchTerm_.push_back(txt[i]);
             t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-            redraw();
+            requestFrame();
         } else {
             for (int i=0;i<n;i++) { t.input.insert(t.input.begin()+t.cursor, txt[i]); t.cursor++; }
             t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0; // editing snaps back to bottom like terminals
-            redraw();
+            requestFrame();
         }
     }
 }
@@ -1455,9 +1819,24 @@ void TerminalWindow::autocomplete(Tab& t) {
         acDirPrefix_ = token.substr(0, slash + 1);
     }
 
+    // The first word of a command (also after |, ; or &) completes to builtins and PATH executables
+    std::string lead = t.input.substr(0, start);
+    while (!lead.empty() && lead.back() == ' ') lead.pop_back();
+    acCommands_ = !prefix.empty() && slash == std::string::npos &&
+                  (lead.empty() || lead.back() == '|' || lead.back() == ';' || lead.back() == '&');
+
     // Read directory entries
     std::vector<std::string> matches;
-    DIR* d = opendir(dir.c_str());
+    DIR* d = acCommands_ ? nullptr : opendir(dir.c_str());
+    if (acCommands_) {
+        static const char* const kBuiltins[] = {"bgpids", "cd", "clear", "echo", "hash", "history",
+                                                "kill", "killprocess", "multiWatch"};
+        for (const char* b : kBuiltins) if (std::string(b).rfind(prefix, 0) == 0) matches.push_back(b);
+        for (auto& c : commands_.complete(prefix)) {
+            if (std::find(matches.begin(), matches.end(), c) == matches.end()) matches.push_back(c);
+        }
+        std::sort(matches.begin(), matches.end());
+    }
     if (d) {
         struct dirent* ent;
         while ((ent = readdir(d)) != nullptr) {
@@ -1471,6 +1850,7 @@ void TerminalWindow::autocomplete(Tab& t) {
     }
     // Helper to check if a candidate is a directory on disk
     auto is_dir = [&](const std::string& nm) -> bool {
+        if (acCommands_) return false;
         std::string base = dir.empty() ? std::string(".") : dir;
         std::string path = base;
         if (path != "/") path += "/";
@@ -1491,7 +1871,7 @@ void TerminalWindow::autocomplete(Tab& t) {
         std::string insert = acDirPrefix_ + matches[0] + (dirp ? "/" : "");
         t.input = before + insert + after;
         t.cursor = (before + insert).size();
-        redraw();
+        requestFrame();
         return;
     }
     // Multiple: compute longest common prefix among matches relative to current prefix
@@ -1512,7 +1892,7 @@ void TerminalWindow::autocomplete(Tab& t) {
         std::string after  = t.input.substr(acReplaceEnd_);
         t.input = before + acDirPrefix_ + common + after;
         t.cursor = (before + acDirPrefix_ + common).size();
-        redraw();
+        requestFrame();
         return;
     }
     // Still ambiguous: present numbered choices
@@ -1521,18 +1901,22 @@ void TerminalWindow::autocomplete(Tab& t) {
     // Echo current prompt+input to scrollback so choices appear after it
     {
         std::string ps1 = get_user()+"@"+get_host()+":"+get_cwd()+"$ ";
-        size_t mark = t.scrollback.size();
+        size_t mark = t.scrollback.endOffset();
         t.appendOutput(ps1 + t.input + "\n");
         acScrollbackMark_ = mark;
     }
-    t.appendOutput("Select a file: ");
-    for (size_t i=0;i<matches.size(); ++i) {
+    // Only 1..9 can be picked: long command lists are cut there
+    size_t shown = acCommands_ ? std::min<size_t>(matches.size(), 9) : matches.size();
+    t.appendOutput(acCommands_ ? "Select a command: " : "Select a file: ");
+    for (size_t i=0;i<shown; ++i) {
         bool dirp = is_dir(matches[i]);
         std::string disp = matches[i] + (dirp?"/":"");
-        t.appendOutput(std::to_string(i+1) + ". " + disp + (i+1<matches.size()?" ":"\n"));
+        t.appendOutput(std::to_string(i+1) + ". " + disp + (i+1<shown?" ":"\n"));
     }
+    if (shown < matches.size()) t.appendOutput("(" + std::to_string(matches.size() - shown) + " more, type more of the name)\n");
+    autocompleteChoices_.resize(shown);
     t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-    redraw();
+    requestFrame();
 }
 
 void TerminalWindow::handleButton(XButtonEvent* e) {
@@ -1543,7 +1927,7 @@ void TerminalWindow::handleButton(XButtonEvent* e) {
     int closeW = 16;
     if (e->y>=6 && e->y<=6+tabH) {
         int xPlus = 8 + (int)tabs_.size()*(tabW + tabSpacing);
-        if (e->button==Button1 && e->x>=xPlus && e->x<=xPlus+28) { newTab(); activeTab_ = (int)tabs_.size()-1; redraw(); return; }
+        if (e->button==Button1 && e->x>=xPlus && e->x<=xPlus+28) { newTab(); activeTab_ = (int)tabs_.size()-1; requestFrame(); return; }
         // Check tabs hit test precisely
         for (int i=0;i<(int)tabs_.size();++i) {
             int xStart = 8 + i*(tabW + tabSpacing);
@@ -1554,7 +1938,7 @@ void TerminalWindow::handleButton(XButtonEvent* e) {
                     if (e->x >= closeX && e->x <= closeX + closeW && e->y >= closeY && e->y <= closeY + 16) {
                         closeTab(i);
                     } else {
-                        activeTab_=i; redraw();
+                        activeTab_=i; requestFrame();
                     }
                 }
                 return;
@@ -1566,19 +1950,16 @@ void TerminalWindow::handleButton(XButtonEvent* e) {
     Tab& t = *tabs_[activeTab_];
     // Middle-click paste from PRIMARY selection
     if (e->button == Button2) { requestPaste(XA_PRIMARY); return; }
-    if (e->button == Button4) { t.scrollOffsetTargetLines = t.scrollOffsetLines + 3; redraw(); return; }
-    if (e->button == Button5) { t.scrollOffsetTargetLines = std::max(0, t.scrollOffsetLines - 3); redraw(); return; }
+    if (e->button == Button4) { t.scrollOffsetTargetLines = t.scrollOffsetLines + 3; requestFrame(); return; }
+    if (e->button == Button5) { t.scrollOffsetTargetLines = std::max(0, t.scrollOffsetLines - 3); requestFrame(); return; }
     // Scrollbar interactions
     const int sbW = 12; int trackX = width_ - sbW - 2; int trackTop = 40; int trackH = height_ - 40 - lineH_;
     if (e->button == Button1 && e->x >= trackX) {
-        // Rebuild lines
-        size_t start=0; std::vector<std::string> lines;
-        for (size_t i=0;i<t.scrollback.size();++i) if (t.scrollback[i]=='\n') { lines.emplace_back(t.scrollback.substr(start,i-start)); start=i+1; }
-        if (start<t.scrollback.size()) lines.emplace_back(t.scrollback.substr(start));
-        int total = (int)lines.size();
-        int viewportLines = std::max(1,(height_ - 40 - 2*lineH_)/lineH_);
-        int bottomStart = std::max(0,(int)lines.size()-viewportLines);
-        int begin = std::max(0, bottomStart - std::max(0, t.scrollOffsetLines));
+        // Same geometry the last frame drew the scrollbar with
+        int total = lastTotalLines_;
+        int viewportLines = lastViewportLines_;
+        int bottomStart = std::max(0,total-viewportLines);
+        int begin = lastBeginLine_;
 
         // Determine current thumb geometry
         double thumbHpx = std::max(20.0, (double)trackH * (double)viewportLines / std::max(1,total));
@@ -1601,21 +1982,21 @@ void TerminalWindow::handleButton(XButtonEvent* e) {
             int targetBegin = (int)(clickFrac * maxBegin);
             int targetOffsetFromBottom = std::max(0, bottomStart - targetBegin);
             t.scrollOffsetTargetLines = targetOffsetFromBottom;
-            redraw();
+            requestFrame();
             return;
         }
     }
     // Right-click on track: page up/down by a viewport
     if (e->button == Button3 && e->x >= trackX) {
         // Page up/down by one viewport relative to current thumb position
-        int viewportLines = std::max(1,(height_ - 40 - 2*lineH_)/lineH_);
+        int viewportLines = lastViewportLines_;
         int thumbY = lastThumbY_;
         if (e->y < thumbY) {
             t.scrollOffsetTargetLines = t.scrollOffsetLines + viewportLines;
         } else {
             t.scrollOffsetTargetLines = std::max(0, t.scrollOffsetLines - viewportLines);
         }
-        redraw();
+        requestFrame();
         return;
     }
 }
@@ -1631,23 +2012,19 @@ void TerminalWindow::handleMotion(XMotionEvent* e) {
         if (!hn) {
             for (int i=0;i<(int)tabs_.size();++i) { int xStart=8+i*(tabW+8); if (e->x>=xStart && e->x<=xStart+tabW) { hi=i; break; } }
         }
-        if (hoverNewTab_!=hn || hoverTabIndex_!=hi) { hoverNewTab_=hn; hoverTabIndex_=hi; redraw(); }
+        if (hoverNewTab_!=hn || hoverTabIndex_!=hi) { hoverNewTab_=hn; hoverTabIndex_=hi; requestFrame(); }
     } else {
-        if (hoverNewTab_||hoverTabIndex_!=-1) { hoverNewTab_=false; hoverTabIndex_=-1; redraw(); }
+        if (hoverNewTab_||hoverTabIndex_!=-1) { hoverNewTab_=false; hoverTabIndex_=-1; requestFrame(); }
     }
     // Hover detection for scrollbar thumb
     const int sbW = 12; int x = width_ - sbW - 2; int trackTop = 40; int trackH = height_ - 40 - lineH_;
     bool overScroll = (e->x >= x && e->y >= trackTop && e->y <= trackTop+trackH);
     bool overThumb = overScroll && lastThumbY_>=0 && e->y>=lastThumbY_ && e->y<=lastThumbY_+lastThumbH_;
-    if (hoverScrollbarThumb_ != overThumb) { hoverScrollbarThumb_ = overThumb; redraw(); }
+    if (hoverScrollbarThumb_ != overThumb) { hoverScrollbarThumb_ = overThumb; requestFrame(); }
 
     if (!draggingScrollbar_) return;
-    // reconstruct lines
-    size_t start=0; std::vector<std::string> lines;
-    for (size_t i=0;i<t.scrollback.size();++i) if (t.scrollback[i]=='\n') { lines.emplace_back(t.scrollback.substr(start,i-start)); start=i+1; }
-    if (start<t.scrollback.size()) lines.emplace_back(t.scrollback.substr(start));
-    int total = (int)lines.size();
-    int viewportLines = std::max(1,(height_ - 40 - 2*lineH_)/lineH_);
+    int total = lastTotalLines_;
+    int viewportLines = lastViewportLines_;
     int dy = e->y - dragStartY_;
     double thumbHpx = std::max(20.0, (double)trackH * (double)viewportLines / std::max(1,total));
     double trackMovable = (double)trackH - thumbHpx;
@@ -1657,7 +2034,7 @@ void TerminalWindow::handleMotion(XMotionEvent* e) {
     begin = std::clamp(begin, 0, maxBegin);
     int bottomStart = std::max(0, total - viewportLines);
     t.scrollOffsetTargetLines = std::max(0, bottomStart - begin);
-    redraw();
+    requestFrame();
 }
 
 void TerminalWindow::handleButtonRelease(XButtonEvent*) {
@@ -1665,7 +2042,7 @@ void TerminalWindow::handleButtonRelease(XButtonEvent*) {
 }
 
 void TerminalWindow::newTab() {
-    tabs_.emplace_back(std::make_unique<Tab>());
+    tabs_.emplace_back(std::make_unique<Tab>(scrollbackLines_, scrollbackBytes_));
 }
 
 void TerminalWindow::closeTab(int index) {
@@ -1691,75 +2068,89 @@ void TerminalWindow::closeTab(int index) {
             activeTab_ = std::max(0, index - 1);
         }
         if (tabs_.empty()) { exit(0); }
-        redraw();
+        requestFrame();
     }
 }
 
+void TerminalWindow::restartBlink() {
+    cursorOn_ = true;
+    if (focused_) blinkTimer_.every(blinkMs_);
+}
+
+bool TerminalWindow::isShown(const Tab& t) const {
+    return !tabs_.empty() && tabs_[activeTab_].get() == &t;
+}
+
 void TerminalWindow::run() {
     initHistory();
     initX11();
 
-    int x11fd = ConnectionNumber(dpy_);
-    struct timeval tv;
-    // initialize blink timestamp
-    timespec ts{}; clock_gettime(CLOCK_MONOTONIC, &ts);
-    lastBlinkMs_ = (unsigned long long)ts.tv_sec*1000ull + ts.tv_nsec/1000000ull;
+    // Everything the loop waits for is a descriptor in reactor_: the X connection, the I/O
+    // thread's wakeup, child exits, PATH changes and two timers. With nothing happening it
+    // sleeps until one fires.
+    const int x11fd = ConnectionNumber(dpy_);
+    reactor_.watch(x11fd);
+    reactor_.watch(io_.wakeFd());
+    reactor_.watch(reaper_.fd());
+    reactor_.watch(blinkTimer_.fd());
+    reactor_.watch(frameTimer_.fd());
+    if (commands_.fd() >= 0) reactor_.watch(commands_.fd());
+    restartBlink();
+    auto frameDeadline = [&] {
+        return lastFrameUs_ + (unsigned long long)frameIntervalUs_ * (frameInteractive_ ? 1 : 1 + frameSkip_);
+    };
     while (true) {
-        fd_set rfds; FD_ZERO(&rfds); FD_SET(x11fd, &rfds);
-        int maxfd = x11fd;
-        // add child pipes for active tab (non-blocking read)
-        if (!tabs_.empty()) {
-            Tab& t = *tabs_[activeTab_];
-            if (t.outFd>=0) { FD_SET(t.outFd, &rfds); if (t.outFd>maxfd) maxfd=t.outFd; }
-            if (t.errFd>=0) { FD_SET(t.errFd, &rfds); if (t.errFd>maxfd) maxfd=t.errFd; }
-            // add background jobs
-            for (auto& bj : t.backgroundJobs) {
-                if (bj.outFd>=0) { FD_SET(bj.outFd, &rfds); if (bj.outFd>maxfd) maxfd=bj.outFd; }
-                if (bj.errFd>=0) { FD_SET(bj.errFd, &rfds); if (bj.errFd>maxfd) maxfd=bj.errFd; }
-            }
+        // Background reflow after a resize: one slice per tab per iteration, don't sleep while work remains
+        bool reflowing = false;
+        for (auto& pt : tabs_) if (pt->wrap.reflowStep(kReflowSlice)) reflowing = true;
+        // Frame scheduler: the frame timer goes off when the next frame is due
+        if (frameDue_) {
+            unsigned long long due = frameDeadline();
+            if (due != frameTimerUs_) { frameTimer_.at(due); frameTimerUs_ = due; }
         }
-        tv.tv_sec = 0; tv.tv_usec = tickMs_ * 1000; // ~60fps
-        int r = select(maxfd+1, &rfds, nullptr, nullptr, &tv);
-        // compute elapsed time for blinking regardless of select wake reason
-        clock_gettime(CLOCK_MONOTONIC, &ts);
-        unsigned long long nowMs = (unsigned long long)ts.tv_sec*1000ull + ts.tv_nsec/1000000ull;
-        unsigned long long elapsed = nowMs - lastBlinkMs_;
-        if (elapsed >= (unsigned long long)tickMs_) {
-            lastBlinkMs_ = nowMs;
-            blinkCountdownMs_ -= (int)elapsed;
-            if (blinkCountdownMs_ <= 0) { cursorOn_ = !cursorOn_; blinkCountdownMs_ = blinkMs_; redraw(); }
-        }
-        if (r>0) {
-            // Check child pipes
-            if (!tabs_.empty()) {
-                Tab& t = *tabs_[activeTab_];
-                if (t.outFd>=0 && FD_ISSET(t.outFd, &rfds)) pumpChildOutput();
-                if (t.errFd>=0 && FD_ISSET(t.errFd, &rfds)) pumpChildOutput();
-                // Check background jobs
-                for (auto& bj : t.backgroundJobs) {
-                    if (bj.outFd>=0 && FD_ISSET(bj.outFd, &rfds)) drainBackgroundJobs();
-                    if (bj.errFd>=0 && FD_ISSET(bj.errFd, &rfds)) drainBackgroundJobs();
-                }
+        // Xlib may already hold events read off the connection; those don't make it readable
+        int timeoutMs = -1;
+        if (reflowing || ioBacklog_ || XEventsQueued(dpy_, QueuedAfterFlush) > 0) timeoutMs = 0;
+
+        int n = reactor_.wait(timeoutMs);
+        bool ioReady = false;
+        for (int i = 0; i < n; ++i) {
+            int fd = reactor_.readyFd(i);
+            if (fd == blinkTimer_.fd()) {
+                if (blinkTimer_.consume() && focused_) { cursorOn_ = !cursorOn_; updateCaret(); XFlush(dpy_); }
+            } else if (fd == frameTimer_.fd()) {
+                frameTimer_.consume();
+                frameTimerUs_ = 0;
+            } else if (fd == io_.wakeFd()) {
+                io_.clearWake();
+                ioReady = true;
+            } else if (fd == reaper_.fd()) {
+                handleChildExits();
+            } else if (fd == commands_.fd()) {
+                commands_.handleEvents();
             }
+            // x11fd: events are handled below
         }
-        // Even if no FDs were readable, poll child exit occasionally to avoid being stuck when
-        // the child closes pipes earlier or produces no output (no more FD events).
-        if (!tabs_.empty()) {
-            Tab& t = *tabs_[activeTab_];
-            if (t.childPid > 0) pumpChildOutput();
-            drainBackgroundJobs();
-        }
-        // Smooth scrolling: if any tab is animating, redraw
+        if (ioReady || ioBacklog_) ioBacklog_ = pumpChildOutput();
+        // Smooth scrolling: if any tab is animating, keep frames coming
         bool anim = false;
         for (auto& pt : tabs_) {
             if (pt->scrollOffsetLines != pt->scrollOffsetTargetLines) { anim = true; break; }
         }
-        if (anim) redraw();
+        if (anim) requestFrame();
         while (XPending(dpy_)) {
             XEvent ev; XNextEvent(dpy_, &ev);
             switch (ev.type) {
-                case Expose: redraw(); break;
-                case KeyPress: cursorOn_ = true; blinkCountdownMs_ = blinkMs_; handleKeyPress(&ev.xkey); break;
+                case Expose:
+                    // The last frame is still in the back buffer: copy the exposed part back
+                    if (back_.valid() && back_.width() == width_ && back_.height() == height_) {
+                        back_.present(win_, gc_, ev.xexpose.x, ev.xexpose.y, ev.xexpose.width, ev.xexpose.height);
+                        updateCaret();
+                    } else {
+                        requestFrame();
+                    }
+                    break;
+                case KeyPress: restartBlink(); handleKeyPress(&ev.xkey); break;
                 case ButtonPress:
                     if (ev.xbutton.button == 4 || ev.xbutton.button == 5) { // Scroll wheel
                         if (activeTab_ >= 0) {
@@ -1767,7 +2158,7 @@ void TerminalWindow::run() {
                             int direction = (ev.xbutton.button == 4) ? 1 : -1;
                             int scrollAmount = 3; // lines
                             t.scrollOffsetTargetLines = std::max(0, t.scrollOffsetLines + direction * scrollAmount);
-                            redraw();
+                            requestFrame();
                         }
                     } else {
                         handleButton(&ev.xbutton);
@@ -1775,12 +2166,20 @@ void TerminalWindow::run() {
                     break;
                 case ButtonRelease: handleButtonRelease(&ev.xbutton); break;
                 case MotionNotify: handleMotion(&ev.xmotion); break;
-                case ConfigureNotify: width_=ev.xconfigure.width; height_=ev.xconfigure.height; redraw(); break;
-                case FocusIn: focused_ = true; cursorOn_ = true; blinkCountdownMs_ = blinkMs_; redraw(); break;
-                case FocusOut: focused_ = false; cursorOn_ = false; redraw(); break;
+                case ConfigureNotify:
+                    width_=ev.xconfigure.width; height_=ev.xconfigure.height;
+                    // Row counts of every tab go stale; visible lines are re-wrapped by the next frame, the rest in the loop below.
+                    // Emulator grids and running PTY jobs take the new size in cells.
+                    for (auto& pt : tabs_) { pt->wrap.setColumns(wrapColumns()); resizeTerminal(*pt); }
+                    requestFrame();
+                    break;
+                case FocusIn: focused_ = true; restartBlink(); requestFrame(); break;
+                case FocusOut: focused_ = false; cursorOn_ = false; blinkTimer_.disarm(); requestFrame(); break;
                 case SelectionNotify: handleSelectionNotify(&ev.xselection); break;
             }
         }
+        // At most one frame per interval, however many producers asked for it
+        if (frameDue_ && monotonic_us() >= frameDeadline()) renderFrame();
     }
 }
 void TerminalWindow::drawScrollBar(int totalLines, int viewportLines, int beginLine) {
@@ -1856,39 +2255,6 @@ static std::string normalize_paste_text(const std::string& in) {
     return out;
 }
 
-// Return true when the string has balanced single and double quotes.
-static bool quotes_balanced_simple(const std::string& s) {
-    bool inS = false, inD = false;
-    for (char c : s) {
-        if (c=='"' && !inS) inD = !inD; else if (c=='\'' && !inD) inS = !inS;
-    }
-    return !inS && !inD;
-}
-
-// Split by newlines that are NOT inside quotes. Preserves newlines that are
-// within quotes (so a multi-line quoted string stays a single command).
-static std::vector<std::string> split_lines_respecting_quotes(const std::string& s) {
-    std::vector<std::string> out;
-    std::string cur;
-    bool inS=false, inD=false;
-    for (char c : s) {
-        if (c=='"' && !inS) { inD = !inD; cur.push_back(c); continue; }
-        if (c=='\'' && !inD) { inS = !inS; cur.push_back(c); continue; }
-        if (c=='\n' && !inS && !inD) {
-            // newline as separator
-            // trim whitespace-only cur
-            bool onlyWs = true; for (char k: cur) { if (!isspace((unsigned char)k)) { onlyWs=false; break; } }
-            if (!cur.empty() && !onlyWs) out.push_back(cur);
-            cur.clear();
-        } else {
-            cur.push_back(c);
-        }
-    }
-    bool onlyWs = true; for (char k: cur) { if (!isspace((unsigned char)k)) { onlyWs=false; break; } }
-    if (!cur.empty() && !onlyWs) out.push_back(cur);
-    return out;
-}
-
 void TerminalWindow::handlePaste(const std::string& text) {
     if (tabs_.empty()) return;
     Tab& t = *tabs_[activeTab_];
@@ -1902,18 +2268,19 @@ void TerminalWindow::handlePaste(const std::string& text) {
     t.cursor = before.size() + cleaned.size();
     // Snap to bottom and make caret visible immediately after paste
     t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
-    cursorOn_ = true; blinkCountdownMs_ = blinkMs_;
-    redraw();
+    restartBlink();
+    requestFrame();
 }
 
 void TerminalWindow::submitInputLine(Tab& t, bool triggerRedraw) {
-    // Continuation mode for unterminated quotes OR backslash-newline joins
+    // Continuation mode for unterminated quotes, dangling | && || OR backslash-newline joins
     auto ends_with_backslash = [](const std::string& s){ return !s.empty() && s.back()=='\\'; };
+    ParsedScript script;
     if (!t.contActive) {
         if (!t.input.empty() && !isWhitespaceOnly(t.input)) {
-            bool unbalanced = !quotes_balanced_simple(t.input);
             bool bscont = ends_with_backslash(t.input);
-            if (unbalanced || bscont) {
+            if (!bscont) script = parseShell(t.input);
+            if (script.incomplete || bscont) {
                 t.contActive = true;
                 std::string typed = t.input; // keep exactly what the user saw (including trailing '\\' if present)
                 if (bscont) {
@@ -1930,7 +2297,7 @@ void TerminalWindow::submitInputLine(Tab& t, bool triggerRedraw) {
                 // Echo without the trailing backslash (continuation marker shouldn't appear in transcript)
                 std::string visible = bscont && !typed.empty() ? typed.substr(0, typed.size()-1) : typed;
                 t.appendOutput(ps1 + visible + "\n");
-                if (triggerRedraw) redraw();
+                if (triggerRedraw) requestFrame();
                 return;
             }
         }
@@ -1954,74 +2321,70 @@ void TerminalWindow::submitInputLine(Tab& t, bool triggerRedraw) {
             t.contJoinNoNewline = true;
         } else {
             t.contJoinNoNewline = false;
+            script = parseShell(t.contBuffer);
         }
-        bool unbalanced = !quotes_balanced_simple(t.contBuffer);
-        if (unbalanced || bscont) {
-            if (triggerRedraw) redraw();
+        if (script.incomplete || bscont) {
+            if (triggerRedraw) requestFrame();
             return;
         }
         // fallthrough to execution with contBuffer
     }
 
-    // Build command list: bracketed paste can include multiple commands separated by newlines
-    std::vector<std::string> cmds;
-    if (t.contActive) {
-        // Single logical command containing embedded newlines
-        cmds.push_back(t.contBuffer);
-    } else if (!t.input.empty() && !isWhitespaceOnly(t.input)) {
-        cmds = split_lines_respecting_quotes(t.input);
-    }
-
-    if (!cmds.empty()) {
+    // The script holds every complete command line: bracketed paste can include several
+    if (!script.lines.empty()) {
         // For continuation, we've already echoed PS1 first line and each PS2 line as user hit Enter.
         // For non-continuation (e.g., bracketed paste), echo once now.
         if (!t.contActive) {
             std::string ps1 = get_user()+"@"+get_host()+":"+get_cwd()+"$ ";
-            t.appendOutput(ps1 + cmds[0] + "\n");
-            for (size_t i=1;i<cmds.size(); ++i) t.appendOutput(std::string("> ") + cmds[i] + "\n");
-        }
-        // Queue commands without echoing again (respect semicolons outside quotes)
-        auto split_by_semicolon = [](const std::string& s){
-            std::vector<std::string> out; std::string cur; bool inS=false, inD=false;
-            for (size_t i=0;i<s.size();++i){ char c=s[i];
-                if (c=='"' && !inS) inD=!inD; else if (c=='\'' && !inD) inS=!inS;
-                else if (!inS && !inD && c==';') { if (!cur.empty()) { out.push_back(cur); cur.clear(); } continue; }
-                cur.push_back(c);
-            }
-            if (!cur.empty()) out.push_back(cur);
-            return out;
-        };
-        for (auto& c : cmds) {
-            auto pieces = split_by_semicolon(c);
-            if (pieces.empty()) continue;
-            for (auto& p : pieces) {
-                if (!isWhitespaceOnly(p)) t.pendingCmds.emplace_back(p, false);
-            }
-            // Keep history as the original line (like shells do)
-            addHistoryEntry(c);
+            t.appendOutput(ps1 + script.lines[0] + "\n");
+            for (size_t i=1;i<script.lines.size(); ++i) t.appendOutput(std::string("> ") + script.lines[i] + "\n");
+        }
+        // Keep history as the original lines (like shells do)
+        for (auto& l : script.lines) addHistoryEntry(l);
+        if (!script.error.empty()) {
+            t.appendOutput(script.error + "\n");
+            t.lastExitStatus = 2 << 8;
+        } else {
+            // Queue the pipelines without echoing again
+            for (auto& p : script.pipelines) t.pendingCmds.push_back(PendingCommand{std::move(p), std::string()});
+            runNextCommand(t);
         }
-        runNextCommand(t);
     }
     // reset state for next prompt
     t.scrollOffsetLines = 0; t.scrollOffsetTargetLines = 0;
     t.input.clear(); t.cursor=0;
     if (t.contActive) { t.contActive=false; t.contBuffer.clear(); }
     t.contJoinNoNewline = false;
-    if (triggerRedraw) redraw();
+    if (triggerRedraw) requestFrame();
 }
 
 void TerminalWindow::runNextCommand(Tab& t) {
     if (t.childPid>0) return; // busy
-    if (t.pendingCmds.empty()) return;
-    auto pair = t.pendingCmds.front();
-    std::string line = pair.first; bool echo = pair.second;
-    t.pendingCmds.pop_front();
-    executeLineInternal(line, echo);
+    while (!t.pendingCmds.empty()) {
+        PendingCommand pc = std::move(t.pendingCmds.front());
+        t.pendingCmds.pop_front();
+        // && and || look at how the previous pipeline went
+        bool succeeded = t.lastExitStatus == 0;
+        if ((pc.pipeline.join == Connector::And && !succeeded) || (pc.pipeline.join == Connector::Or && succeeded)) continue;
+        // A queue advanced by a tab in the background runs in that tab, not the active one
+        executePipeline(t, pc.pipeline, pc.echo);
+        return;
+    }
 }
 
 bool TerminalWindow::executeSingleCommand(Tab& t, const std::string& line, bool echoPromptAndCmd) {
     if (line.empty() || isWhitespaceOnly(line)) return true;
-    t.pendingCmds.emplace_back(line, echoPromptAndCmd);
+    ParsedScript script = parseShell(line);
+    if (script.incomplete) script.error = "syntax error: unexpected end of input";
+    if (!script.error.empty()) {
+        if (echoPromptAndCmd) t.appendOutput(get_user()+"@"+get_host()+":"+get_cwd()+"$ " + line + "\n");
+        t.appendOutput(script.error + "\n");
+        return false;
+    }
+    for (size_t i = 0; i < script.pipelines.size(); ++i) {
+        std::string echo = echoPromptAndCmd && i == 0 ? line : std::string();
+        t.pendingCmds.push_back(PendingCommand{std::move(script.pipelines[i]), echo});
+    }
     runNextCommand(t);
     return true;
 }
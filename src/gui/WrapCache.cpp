@@ -0,0 +1,157 @@
+#include "gui/WrapCache.hpp"
+#include <algorithm>
+
+namespace myterm {
+
+void WrapCache::setColumns(int cols) {
+    cols = std::max(1, cols);
+    if (cols == cols_) return;
+    cols_ = cols;
+    if (entries_.empty()) return;
+    reflowPending_ = true;
+    reflowNext_ = first_ + entries_.size();
+}
+
+void WrapCache::segment(Entry& e, std::string_view line, const Segmenter& seg) {
+    e.bounds.clear();
+    bool ascii = std::all_of(line.begin(), line.end(), [](char c) { return (unsigned char)c < 0x80; });
+    if (ascii || !seg) {
+        e.graphemes = (uint32_t)line.size();
+    } else {
+        scratch_.clear();
+        seg(line, scratch_);
+        if (scratch_.size() < 2 || scratch_.front() != 0 || scratch_.back() != line.size()) {
+            // Segmenter gave up: fall back to bytes so offsets stay inside the line
+            e.graphemes = (uint32_t)line.size();
+        } else {
+            e.graphemes = (uint32_t)(scratch_.size() - 1);
+            if (e.graphemes != line.size()) e.bounds.assign(scratch_.begin(), scratch_.end());
+        }
+    }
+    e.cols = 0; // force refresh()
+    e.rows = 0;
+}
+
+void WrapCache::refresh(size_t i) {
+    Entry& e = entries_[i];
+    if (e.cols == cols_) return;
+    // Empty lines take no rows (matches the previous per-frame wrapping)
+    uint32_t rows = (e.graphemes + (uint32_t)cols_ - 1) / (uint32_t)cols_;
+    treeAdd(first_ + i, (int64_t)rows - (int64_t)e.rows);
+    totalRows_ = totalRows_ - e.rows + rows;
+    e.rows = rows;
+    e.cols = cols_;
+}
+
+void WrapCache::dropFront() {
+    treeAdd(first_, -(int64_t)entries_.front().rows);
+    totalRows_ -= entries_.front().rows;
+    entries_.pop_front();
+    ++first_;
+}
+
+void WrapCache::dropBack() {
+    treeAdd(first_ + entries_.size() - 1, -(int64_t)entries_.back().rows);
+    totalRows_ -= entries_.back().rows;
+    entries_.pop_back();
+}
+
+void WrapCache::reset(size_t first) {
+    entries_.clear();
+    totalRows_ = 0;
+    first_ = first;
+    treeRebuild();
+}
+
+void WrapCache::treeAdd(size_t absLine, int64_t delta) {
+    if (delta == 0) return;
+    for (size_t k = absLine - treeBase_ + 1; k < tree_.size(); k += k & (~k + 1)) tree_[k] += (size_t)delta;
+}
+
+size_t WrapCache::treePrefix(size_t absLine) const {
+    size_t sum = 0;
+    for (size_t k = absLine - treeBase_; k > 0; k -= k & (~k + 1)) sum += tree_[k];
+    return sum;
+}
+
+void WrapCache::treeRebuild() {
+    // Rebase on the oldest line and leave room to append as many lines again before the next rebuild
+    size_t cap = 1024;
+    while (cap < entries_.size() * 2) cap *= 2;
+    treeBase_ = first_;
+    tree_.assign(cap + 1, 0);
+    for (size_t k = 1; k <= entries_.size(); ++k) tree_[k] = entries_[k - 1].rows;
+    for (size_t k = 1; k <= cap; ++k) {
+        size_t parent = k + (k & (~k + 1));
+        if (parent <= cap) tree_[parent] += tree_[k];
+    }
+}
+
+void WrapCache::sync(ScrollbackStore& store, const Segmenter& seg) {
+    const size_t storeFirst = store.firstLine();
+    const size_t dirty = store.takeDirtyFrom();
+    if (tree_.empty() || storeFirst < first_ || storeFirst >= first_ + entries_.size()) {
+        // Fresh start, contents swapped in, or everything cleared/evicted since the last sync
+        if (!entries_.empty() || first_ != storeFirst || tree_.empty()) reset(storeFirst);
+    }
+    while (!entries_.empty() && first_ < storeFirst) dropFront();
+    while (!entries_.empty() && (first_ + entries_.size() > dirty || entries_.size() > store.lineCount())) dropBack();
+    for (size_t i = entries_.size(), n = store.lineCount(); i < n; ++i) {
+        entries_.emplace_back();
+        segment(entries_.back(), store.line(i), seg);
+        if (first_ + i - treeBase_ + 1 >= tree_.size()) treeRebuild();
+        refresh(i);
+    }
+    reflowNext_ = std::min(std::max(reflowNext_, first_), first_ + entries_.size());
+    if (reflowNext_ == first_) reflowPending_ = false;
+}
+
+int WrapCache::rows(size_t i) {
+    refresh(i);
+    return (int)entries_[i].rows;
+}
+
+std::pair<size_t, int> WrapCache::locate(size_t row) const {
+    // Descend the tree for the first line whose cumulative rows exceed `row`
+    size_t pos = 0;
+    size_t step = 1;
+    while (step * 2 < tree_.size()) step *= 2;
+    for (; step > 0; step /= 2) {
+        if (pos + step < tree_.size() && tree_[pos + step] <= row) {
+            pos += step;
+            row -= tree_[pos];
+        }
+    }
+    return {treeBase_ + pos - first_, (int)row};
+}
+
+std::pair<size_t, size_t> WrapCache::rowRange(size_t i, int row) {
+    refresh(i);
+    const Entry& e = entries_[i];
+    size_t startG = std::min<size_t>((size_t)row * (size_t)cols_, e.graphemes);
+    size_t endG = std::min<size_t>(startG + (size_t)cols_, e.graphemes);
+    if (e.bounds.empty()) return {startG, endG};
+    return {e.bounds[startG], e.bounds[endG]};
+}
+
+std::string_view WrapCache::rowText(const ScrollbackStore& store, size_t i, int row) {
+    auto r = rowRange(i, row);
+    return store.line(i).substr(r.first, r.second - r.first);
+}
+
+bool WrapCache::reflowStep(size_t budget) {
+    if (!reflowPending_) return false;
+    while (budget > 0 && reflowNext_ > first_) {
+        refresh(--reflowNext_ - first_);
+        --budget;
+    }
+    if (reflowNext_ <= first_) reflowPending_ = false;
+    return reflowPending_;
+}
+
+void WrapCache::reflowVisible(size_t rows) {
+    // Lines from reflowNext_ on are current, so their rows are exactly those at the bottom
+    while (reflowPending_ && totalRows_ - treePrefix(reflowNext_) < rows) reflowStep(256);
+}
+
+} // namespace myterm